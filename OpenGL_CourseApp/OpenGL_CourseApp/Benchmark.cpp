@@ -0,0 +1,243 @@
+#include "Benchmark.h"
+
+#include <errno.h>
+#include <limits.h>
+
+static void PrintUsage()
+{
+	printf("Usage: OpenGL_CourseApp [--omni geometry|layered|faces] [--benchmark [--frames N] [--size WxH] [--timestep seconds] [--csv file]]\n");
+}
+
+Benchmark::Benchmark()
+{
+	enabled = false;
+	width = 1366;
+	height = 768;
+	timeStep = 1.0f / 60.0f;
+	frameCount = 1000;
+	outputFile = "benchmark.csv";
+
+	framebuffer = 0;
+	colourBuffer = 0;
+	depthBuffer = 0;
+
+	memset(queries, 0, sizeof(queries));
+	hasTimer = false;
+	finishTime = 0.0;
+}
+
+bool Benchmark::ParseArguments(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			enabled = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && hasValue)
+		{
+			//Whole positive counts only, atoi would turn "abc" into 0 and wrap negatives.
+			const char* value = argv[++i];
+			char* end = nullptr;
+			errno = 0;
+			long frames = strtol(value, &end, 10);
+			if (end == value || *end != '\0' || errno == ERANGE || frames <= 0 || frames > INT_MAX)
+			{
+				printf("Expected --frames <positive whole number>, got '%s'\n", value);
+				PrintUsage();
+				return false;
+			}
+			frameCount = (unsigned int)frames;
+		}
+		else if (strcmp(argv[i], "--size") == 0 && hasValue)
+		{
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+			{
+				printf("Expected --size <width>x<height>\n");
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--timestep") == 0 && hasValue)
+		{
+			timeStep = (GLfloat)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--csv") == 0 && hasValue)
+		{
+			outputFile = argv[++i];
+		}
+		else
+		{
+			printf("Unknown argument '%s'\n", argv[i]);
+			PrintUsage();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Benchmark::CreateTarget()
+{
+	glGenRenderbuffers(1, &colourBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colourBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("Benchmark framebuffer error: %i\n", status);
+		return false;
+	}
+
+	//Timer queries are core since 3.3, but software contexts may still lack them.
+	hasTimer = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	if (hasTimer)
+	{
+		glGenQueries(QUERY_COUNT, queries);
+	}
+
+	startTimes.reserve(frameCount);
+	cpuTimes.reserve(frameCount);
+	gpuTimes.reserve(frameCount);
+
+	benchmarkStart = chrono::high_resolution_clock::now();
+
+	return true;
+}
+
+void Benchmark::BeginFrame()
+{
+	frameStart = chrono::high_resolution_clock::now();
+
+	if (hasTimer)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, queries[cpuTimes.size() % QUERY_COUNT]);
+	}
+}
+
+void Benchmark::EndFrame()
+{
+	if (hasTimer)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+
+	auto now = chrono::high_resolution_clock::now();
+	unsigned int frame = cpuTimes.size();
+
+	startTimes.push_back(chrono::duration<double, milli>(frameStart - benchmarkStart).count());
+	cpuTimes.push_back(chrono::duration<double, milli>(now - frameStart).count());
+	gpuTimes.push_back(-1.0);
+
+	if (frame + 1 >= QUERY_COUNT)
+	{
+		ReadGpuTime(frame + 1 - QUERY_COUNT);
+	}
+
+	//Drain the queries still in flight.
+	if (IsFinished())
+	{
+		for (unsigned int i = frame + 2 > QUERY_COUNT ? frame + 2 - QUERY_COUNT : 0; i <= frame; i++)
+		{
+			ReadGpuTime(i);
+		}
+
+		finishTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - benchmarkStart).count();
+	}
+}
+
+void Benchmark::ReadGpuTime(unsigned int frame)
+{
+	if (!hasTimer)
+	{
+		return;
+	}
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(queries[frame % QUERY_COUNT], GL_QUERY_RESULT, &elapsed);
+	gpuTimes[frame] = elapsed / 1000000.0;
+}
+
+bool Benchmark::WriteResults()
+{
+	FILE* file = fopen(outputFile.c_str(), "w");
+	if (!file)
+	{
+		printf("Failed to write benchmark results to %s\n", outputFile.c_str());
+		return false;
+	}
+
+	fprintf(file, "frame,cpu_ms,gpu_ms,frame_ms\n");
+	for (size_t i = 0; i < cpuTimes.size(); i++)
+	{
+		//Wall time until the next frame started, so it includes waiting on the GPU.
+		double frameTime = (i + 1 < startTimes.size() ? startTimes[i + 1] : finishTime) - startTimes[i];
+		fprintf(file, "%zu,%.4f,%.4f,%.4f\n", i, cpuTimes[i], gpuTimes[i], frameTime);
+	}
+
+	fclose(file);
+
+	if (!cpuTimes.empty())
+	{
+		vector<double> sorted = cpuTimes;
+		sort(sorted.begin(), sorted.end());
+
+		double total = 0.0, gpuTotal = 0.0;
+		for (size_t i = 0; i < cpuTimes.size(); i++)
+		{
+			total += cpuTimes[i];
+			gpuTotal += gpuTimes[i];
+		}
+
+		printf("Benchmark: %zu frames at %ix%i, CPU avg %.3f ms, median %.3f ms, 99th %.3f ms", cpuTimes.size(), width, height,
+			total / cpuTimes.size(), sorted[sorted.size() / 2], sorted[sorted.size() * 99 / 100]);
+
+		if (hasTimer)
+		{
+			printf(", GPU avg %.3f ms", gpuTotal / gpuTimes.size());
+		}
+
+		printf("\nResults written to %s\n", outputFile.c_str());
+	}
+
+	return true;
+}
+
+void Benchmark::ClearTarget()
+{
+	if (framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colourBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		framebuffer = 0;
+		colourBuffer = 0;
+		depthBuffer = 0;
+	}
+
+	if (hasTimer)
+	{
+		glDeleteQueries(QUERY_COUNT, queries);
+		hasTimer = false;
+	}
+}
+
+Benchmark::~Benchmark()
+{
+}
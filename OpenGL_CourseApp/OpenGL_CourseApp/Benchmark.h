@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <GL\glew.h>
+
+using namespace std;
+
+//--benchmark mode: renders a fixed number of frames offscreen into a framebuffer
+//of a chosen size, steps the simulation with a fixed delta and records
+//per-frame CPU and GPU times to a CSV file.
+class Benchmark
+{
+public:
+	Benchmark();
+
+	bool ParseArguments(int argc, char** argv);
+
+	bool IsEnabled() { return enabled; }
+	GLint GetWidth() { return width; }
+	GLint GetHeight() { return height; }
+	GLfloat GetTimeStep() { return timeStep; }
+	GLuint GetFramebuffer() { return framebuffer; }
+
+	bool CreateTarget();
+
+	void BeginFrame();
+	void EndFrame();
+	bool IsFinished() { return cpuTimes.size() >= frameCount; }
+
+	bool WriteResults();
+
+	void ClearTarget();
+
+	~Benchmark();
+
+private:
+	static const unsigned int QUERY_COUNT = 4; //GPU results are read this many frames late, so reading never stalls.
+
+	void ReadGpuTime(unsigned int frame);
+
+	bool enabled;
+	GLint width, height;
+	GLfloat timeStep;
+	unsigned int frameCount;
+	string outputFile;
+
+	GLuint framebuffer, colourBuffer, depthBuffer;
+
+	GLuint queries[QUERY_COUNT];
+	bool hasTimer;
+
+	chrono::high_resolution_clock::time_point benchmarkStart, frameStart;
+	double finishTime;
+
+	//Milliseconds, gpuTimes is -1 when unavailable.
+	vector<double> startTimes, cpuTimes, gpuTimes;
+};
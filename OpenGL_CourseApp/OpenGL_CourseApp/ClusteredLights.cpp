@@ -0,0 +1,295 @@
+#include "ClusteredLights.h"
+
+#include <math.h>
+
+ClusteredLights::ClusteredLights()
+{
+	lightBuffer = gridBuffer = indexBuffer = 0;
+	lightTexture = gridTexture = indexTexture = 0;
+	maxIndices = 65536;
+
+	nearPlane = farPlane = 0.0f;
+	sliceScale = sliceBias = 0.0f;
+	tileScaleX = tileScaleY = 0.0f;
+
+	lightCount = 0;
+	overflowReported = false;
+}
+
+bool ClusteredLights::Init()
+{
+	//Startup leaves errors behind (glewInit on a core context, for one), only this function's count.
+	while (glGetError() != GL_NO_ERROR) {}
+
+	glGenBuffers(1, &lightBuffer);
+	glGenBuffers(1, &gridBuffer);
+	glGenBuffers(1, &indexBuffer);
+
+	glGenTextures(1, &lightTexture);
+	glGenTextures(1, &gridTexture);
+	glGenTextures(1, &indexTexture);
+
+	//Texture buffers need storage before they are attached.
+	glm::vec4 emptyLight[2] = { glm::vec4(0.0f), glm::vec4(0.0f) };
+	glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(emptyLight), emptyLight, GL_STREAM_DRAW);
+
+	vector<unsigned int> emptyGrid(CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z * 2, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned int) * emptyGrid.size(), &emptyGrid[0], GL_STREAM_DRAW);
+
+	unsigned int emptyIndex = 0;
+	glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned int), &emptyIndex, GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	GLState::BindTexture(GL_TEXTURE_BUFFER, lightTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightBuffer);
+	GLState::BindTexture(GL_TEXTURE_BUFFER, gridTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, gridBuffer);
+	GLState::BindTexture(GL_TEXTURE_BUFFER, indexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indexBuffer);
+	GLState::BindTexture(GL_TEXTURE_BUFFER, 0);
+
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxIndices);
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR)
+	{
+		printf("Clustered lights: failed to create texture buffers (0x%x)\n", error);
+		return false;
+	}
+
+	return true;
+}
+
+void ClusteredLights::BuildClusterBounds(const glm::mat4& projectionMatrix)
+{
+	boundsProjection = projectionMatrix;
+
+	//Perspective near and far planes straight from the matrix.
+	nearPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0f);
+	farPlane = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0f);
+
+	GLfloat logRatio = logf(farPlane / nearPlane);
+	sliceScale = CLUSTERS_Z / logRatio;
+	sliceBias = -(GLfloat)CLUSTERS_Z * logf(nearPlane) / logRatio;
+
+	clusterMin.resize(CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z);
+	clusterMax.resize(CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z);
+
+	for (unsigned int z = 0; z < CLUSTERS_Z; z++)
+	{
+		GLfloat sliceNear = nearPlane * powf(farPlane / nearPlane, (GLfloat)z / CLUSTERS_Z);
+		GLfloat sliceFar = nearPlane * powf(farPlane / nearPlane, (GLfloat)(z + 1) / CLUSTERS_Z);
+
+		for (unsigned int y = 0; y < CLUSTERS_Y; y++)
+		{
+			GLfloat ndcBottom = -1.0f + 2.0f * y / CLUSTERS_Y;
+			GLfloat ndcTop = -1.0f + 2.0f * (y + 1) / CLUSTERS_Y;
+
+			for (unsigned int x = 0; x < CLUSTERS_X; x++)
+			{
+				GLfloat ndcLeft = -1.0f + 2.0f * x / CLUSTERS_X;
+				GLfloat ndcRight = -1.0f + 2.0f * (x + 1) / CLUSTERS_X;
+
+				//The tile's corners at both slice depths, view space looks down -z.
+				glm::vec3 minimum(1e30f), maximum(-1e30f);
+				GLfloat depths[2] = { sliceNear, sliceFar };
+				for (int d = 0; d < 2; d++)
+				{
+					glm::vec3 a(ndcLeft * depths[d] / projectionMatrix[0][0], ndcBottom * depths[d] / projectionMatrix[1][1], -depths[d]);
+					glm::vec3 b(ndcRight * depths[d] / projectionMatrix[0][0], ndcTop * depths[d] / projectionMatrix[1][1], -depths[d]);
+					minimum = glm::min(minimum, glm::min(a, b));
+					maximum = glm::max(maximum, glm::max(a, b));
+				}
+
+				unsigned int cluster = x + CLUSTERS_X * (y + CLUSTERS_Y * z);
+				clusterMin[cluster] = minimum;
+				clusterMax[cluster] = maximum;
+			}
+		}
+	}
+}
+
+unsigned int ClusteredLights::GetSlice(GLfloat depth)
+{
+	int slice = (int)floorf(logf(depth) * sliceScale + sliceBias);
+	return slice < 0 ? 0 : (slice >= (int)CLUSTERS_Z ? CLUSTERS_Z - 1 : slice);
+}
+
+void ClusteredLights::Update(const vector<Light>& lights, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
+	GLint width, GLint height)
+{
+	CPU_ZONE("ClusteredLights::Update");
+
+	if (clusterMin.empty() || projectionMatrix != boundsProjection)
+	{
+		BuildClusterBounds(projectionMatrix);
+	}
+
+	tileScaleX = (GLfloat)CLUSTERS_X / width;
+	tileScaleY = (GLfloat)CLUSTERS_Y / height;
+
+	lightCount = lights.size() < MAX_LIGHTS ? (unsigned int)lights.size() : MAX_LIGHTS;
+
+	lightData.resize(lightCount * 2);
+	clusterCounts.assign(CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z, 0);
+	clusterLights.clear();
+
+	for (unsigned int i = 0; i < lightCount; i++)
+	{
+		const Light& light = lights[i];
+		lightData[i * 2] = glm::vec4(light.position, light.range);
+		lightData[i * 2 + 1] = glm::vec4(light.colour, light.intensity);
+
+		glm::vec3 center = glm::vec3(viewMatrix * glm::vec4(light.position, 1.0f));
+		GLfloat depth = -center.z;
+		GLfloat radius = light.range;
+
+		if (depth + radius < nearPlane || depth - radius > farPlane)
+		{
+			continue;
+		}
+
+		unsigned int firstSlice = GetSlice(depth - radius > nearPlane ? depth - radius : nearPlane);
+		unsigned int lastSlice = GetSlice(depth + radius < farPlane ? depth + radius : farPlane);
+
+		//Screen tiles the sphere can cover. A sphere crossing the near plane may cover any of them.
+		int firstX = 0, lastX = CLUSTERS_X - 1, firstY = 0, lastY = CLUSTERS_Y - 1;
+		if (depth - radius > nearPlane)
+		{
+			GLfloat nearDepth = depth - radius, farDepth = depth + radius;
+			GLfloat left = glm::min((center.x - radius) / nearDepth, (center.x - radius) / farDepth) * projectionMatrix[0][0];
+			GLfloat right = glm::max((center.x + radius) / nearDepth, (center.x + radius) / farDepth) * projectionMatrix[0][0];
+			GLfloat bottom = glm::min((center.y - radius) / nearDepth, (center.y - radius) / farDepth) * projectionMatrix[1][1];
+			GLfloat top = glm::max((center.y + radius) / nearDepth, (center.y + radius) / farDepth) * projectionMatrix[1][1];
+
+			if (right < -1.0f || left > 1.0f || top < -1.0f || bottom > 1.0f)
+			{
+				continue;
+			}
+
+			firstX = glm::max(0, (int)floorf((left + 1.0f) * 0.5f * CLUSTERS_X));
+			lastX = glm::min((int)CLUSTERS_X - 1, (int)floorf((right + 1.0f) * 0.5f * CLUSTERS_X));
+			firstY = glm::max(0, (int)floorf((bottom + 1.0f) * 0.5f * CLUSTERS_Y));
+			lastY = glm::min((int)CLUSTERS_Y - 1, (int)floorf((top + 1.0f) * 0.5f * CLUSTERS_Y));
+		}
+
+		for (unsigned int z = firstSlice; z <= lastSlice; z++)
+		{
+			for (int y = firstY; y <= lastY; y++)
+			{
+				for (int x = firstX; x <= lastX; x++)
+				{
+					unsigned int cluster = x + CLUSTERS_X * (y + CLUSTERS_Y * z);
+
+					//Sphere against the cluster box.
+					glm::vec3 closest = glm::clamp(center, clusterMin[cluster], clusterMax[cluster]);
+					glm::vec3 offset = closest - center;
+					if (glm::dot(offset, offset) > radius * radius)
+					{
+						continue;
+					}
+
+					clusterLights.push_back(cluster);
+					clusterLights.push_back(i);
+					clusterCounts[cluster]++;
+				}
+			}
+		}
+	}
+
+	//Prefix sum the counts into ranges, then scatter the light indices.
+	size_t clusterCount = clusterCounts.size();
+	clusterRanges.resize(clusterCount * 2);
+	unsigned int offset = 0;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		clusterRanges[c * 2] = offset;
+		clusterRanges[c * 2 + 1] = 0;
+		offset += clusterCounts[c];
+	}
+
+	if (offset > (unsigned int)maxIndices && !overflowReported)
+	{
+		printf("Clustered lights: %u light indices, only %d fit in a texture buffer\n", offset, maxIndices);
+		overflowReported = true;
+	}
+
+	lightIndices.resize(offset < (unsigned int)maxIndices ? offset : maxIndices);
+	for (size_t p = 0; p < clusterLights.size(); p += 2)
+	{
+		unsigned int cluster = clusterLights[p];
+		unsigned int slot = clusterRanges[cluster * 2] + clusterRanges[cluster * 2 + 1];
+		if (slot < lightIndices.size())
+		{
+			lightIndices[slot] = clusterLights[p + 1];
+			clusterRanges[cluster * 2 + 1]++;
+		}
+	}
+
+	//Orphan and refill, the previous frame may still be reading the old contents.
+	if (lightCount > 0)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * lightData.size(), &lightData[0], GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned int) * clusterRanges.size(), &clusterRanges[0], GL_STREAM_DRAW);
+
+	if (!lightIndices.empty())
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(unsigned int) * lightIndices.size(), &lightIndices[0], GL_STREAM_DRAW);
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLights::UseClusters(GLuint lightsLocation, GLuint gridLocation, GLuint indicesLocation,
+	GLuint tileScaleLocation, GLuint sliceLocation, GLuint textureUnit)
+{
+	GLState::BindTexture(GL_TEXTURE0 + textureUnit, GL_TEXTURE_BUFFER, lightTexture);
+	GLState::Uniform1i(lightsLocation, textureUnit);
+
+	GLState::BindTexture(GL_TEXTURE0 + textureUnit + 1, GL_TEXTURE_BUFFER, gridTexture);
+	GLState::Uniform1i(gridLocation, textureUnit + 1);
+
+	GLState::BindTexture(GL_TEXTURE0 + textureUnit + 2, GL_TEXTURE_BUFFER, indexTexture);
+	GLState::Uniform1i(indicesLocation, textureUnit + 2);
+
+	GLState::Uniform2f(tileScaleLocation, tileScaleX, tileScaleY);
+	GLState::Uniform2f(sliceLocation, sliceScale, sliceBias);
+}
+
+void ClusteredLights::ClearClusters()
+{
+	if (lightTexture != 0)
+	{
+		GLState::ForgetTexture(lightTexture);
+		glDeleteTextures(1, &lightTexture);
+		GLState::ForgetTexture(gridTexture);
+		glDeleteTextures(1, &gridTexture);
+		GLState::ForgetTexture(indexTexture);
+		glDeleteTextures(1, &indexTexture);
+		lightTexture = gridTexture = indexTexture = 0;
+	}
+
+	if (lightBuffer != 0)
+	{
+		glDeleteBuffers(1, &lightBuffer);
+		glDeleteBuffers(1, &gridBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+		lightBuffer = gridBuffer = indexBuffer = 0;
+	}
+
+	clusterMin.clear();
+	clusterMax.clear();
+	lightCount = 0;
+}
+
+ClusteredLights::~ClusteredLights()
+{
+}
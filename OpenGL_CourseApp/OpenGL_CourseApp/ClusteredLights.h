@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+#include "CpuProfiler.h"
+#include "GLState.h"
+
+using namespace std;
+
+//Unshadowed point lights binned into a froxel grid (screen tiles times exponential
+//depth slices). Each frame the lights are culled on the CPU into per-cluster index
+//lists, and the fragment shader only loops over the lights of its own cluster.
+//Lights, cluster ranges and light indices reach the shader through texture buffers.
+class ClusteredLights
+{
+public:
+	static const unsigned int CLUSTERS_X = 16;
+	static const unsigned int CLUSTERS_Y = 9;
+	static const unsigned int CLUSTERS_Z = 24;
+	static const unsigned int MAX_LIGHTS = 4096;
+
+	struct Light
+	{
+		glm::vec3 position;
+		GLfloat range;		//No contribution past this distance.
+		glm::vec3 colour;
+		GLfloat intensity;
+	};
+
+	ClusteredLights();
+
+	bool Init();
+
+	//Bins the lights for a view, projection and viewport size.
+	void Update(const vector<Light>& lights, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
+		GLint width, GLint height);
+
+	//Binds the three buffers to consecutive texture units, starting at textureUnit.
+	void UseClusters(GLuint lightsLocation, GLuint gridLocation, GLuint indicesLocation,
+		GLuint tileScaleLocation, GLuint sliceLocation, GLuint textureUnit);
+
+	unsigned int GetLightCount() { return lightCount; }
+	unsigned int GetIndexCount() { return (unsigned int)lightIndices.size(); }
+
+	void ClearClusters();
+
+	~ClusteredLights();
+
+private:
+	void BuildClusterBounds(const glm::mat4& projectionMatrix);
+	unsigned int GetSlice(GLfloat depth);
+
+	GLuint lightBuffer, gridBuffer, indexBuffer;
+	GLuint lightTexture, gridTexture, indexTexture;
+	GLint maxIndices;
+
+	//View-space cluster boxes, rebuilt when the projection changes.
+	glm::mat4 boundsProjection;
+	vector<glm::vec3> clusterMin, clusterMax;
+	GLfloat nearPlane, farPlane;
+	GLfloat sliceScale, sliceBias;	//slice = log(depth) * sliceScale + sliceBias.
+	GLfloat tileScaleX, tileScaleY; //Tiles per pixel.
+
+	unsigned int lightCount;
+	vector<glm::vec4> lightData;			//Position and range, then colour and intensity.
+	vector<unsigned int> clusterCounts;
+	vector<unsigned int> clusterRanges;		//Offset and count into lightIndices.
+	vector<unsigned int> clusterLights;		//Cluster and light pairs found this frame.
+	vector<unsigned int> lightIndices;
+	bool overflowReported;
+};
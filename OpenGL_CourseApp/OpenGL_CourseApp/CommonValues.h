@@ -6,4 +6,9 @@
 const int MAX_POINT_LIGHTS = 5;
 const int MAX_SPOT_LIGHTS = 3;
 
+//Texture units: 1 diffuse, 2 directional shadow map, 3.. omni shadow maps, then the planet texture array
+//and the three clustered light buffers.
+const int PLANET_TEXTURE_UNIT = 3 + MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS;
+const int CLUSTER_TEXTURE_UNIT = PLANET_TEXTURE_UNIT + 1;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+#ifndef CPU_PROFILER_DISABLED
+thread_local CpuProfiler::ThreadBuffer* CpuProfiler::threadBuffer = nullptr;
+
+mutex CpuProfiler::registryMutex;
+vector<CpuProfiler::ThreadBuffer*> CpuProfiler::buffers;
+
+CpuProfiler::ThreadBuffer* CpuProfiler::RegisterThread()
+{
+	ThreadBuffer* buffer = new ThreadBuffer();
+	buffer->events = new Event[BUFFER_CAPACITY];
+	buffer->count.store(0);
+	buffer->written.store(0);
+	buffer->dropped.store(0);
+
+	lock_guard<mutex> lock(registryMutex);
+	buffer->id = buffers.size() + 1;
+	buffer->name = "Thread " + to_string(buffer->id);
+	buffers.push_back(buffer);
+
+	threadBuffer = buffer;
+	return buffer;
+}
+
+void CpuProfiler::SetThreadName(const char* name)
+{
+	ThreadBuffer* buffer = threadBuffer ? threadBuffer : RegisterThread();
+
+	lock_guard<mutex> lock(registryMutex);
+	buffer->name = name;
+}
+
+//Zone names are plain identifiers, but keep the JSON valid whatever they contain.
+static void WriteJsonString(FILE* file, const char* text)
+{
+	fputc('"', file);
+	for (; *text; text++)
+	{
+		if (*text == '"' || *text == '\\') fputc('\\', file);
+		if ((unsigned char)*text >= 0x20) fputc(*text, file);
+	}
+	fputc('"', file);
+}
+
+bool CpuProfiler::WriteTrace(const string& fileName)
+{
+	FILE* file = fopen(fileName.c_str(), "w");
+	if (!file)
+	{
+		printf("Failed to write CPU trace to %s\n", fileName.c_str());
+		return false;
+	}
+
+	lock_guard<mutex> lock(registryMutex);
+
+	//Timestamps are relative to the earliest event so the viewer starts at zero.
+	uint64_t origin = UINT64_MAX;
+	size_t total = 0, dropped = 0;
+	vector<size_t> counts(buffers.size());
+	for (size_t b = 0; b < buffers.size(); b++)
+	{
+		counts[b] = buffers[b]->count.load(memory_order_acquire);
+		for (size_t i = buffers[b]->written.load(memory_order_relaxed); i < counts[b]; i++)
+		{
+			origin = min(origin, buffers[b]->events[i % BUFFER_CAPACITY].start);
+		}
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	bool first = true;
+	for (size_t b = 0; b < buffers.size(); b++)
+	{
+		ThreadBuffer* buffer = buffers[b];
+		size_t written = buffer->written.load(memory_order_relaxed);
+
+		fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer->id);
+		WriteJsonString(file, buffer->name.c_str());
+		fprintf(file, "}}");
+		first = false;
+
+		for (size_t i = written; i < counts[b]; i++)
+		{
+			const Event& event = buffer->events[i % BUFFER_CAPACITY];
+
+			fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":", buffer->id,
+				(event.start - origin) / 1000.0, (event.end - event.start) / 1000.0);
+			WriteJsonString(file, event.name);
+			fputc('}', file);
+		}
+
+		total += counts[b] - written;
+		dropped += buffer->dropped.load(memory_order_relaxed);
+	}
+
+	fprintf(file, "\n]}\n");
+
+	bool ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+
+	//Only a trace that made it to disk frees its events, a failed one can be retried.
+	if (ok)
+	{
+		for (size_t b = 0; b < buffers.size(); b++)
+		{
+			buffers[b]->written.store(counts[b], memory_order_release);
+			buffers[b]->dropped.store(0, memory_order_relaxed);
+		}
+	}
+
+	printf("CPU trace: %zu zone(s) from %zu thread(s) written to %s", total, buffers.size(), fileName.c_str());
+	if (dropped > 0)
+	{
+		printf(", %zu dropped after the buffers filled", dropped);
+	}
+	printf("\n");
+
+	return ok;
+}
+#endif
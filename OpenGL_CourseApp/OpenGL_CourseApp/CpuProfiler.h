@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+using namespace std;
+
+//Define CPU_PROFILER_DISABLED to compile every CPU_ZONE, thread name and trace out of the build.
+#ifndef CPU_PROFILER_DISABLED
+#define CPU_ZONE_JOIN2(a, b) a##b
+#define CPU_ZONE_JOIN(a, b) CPU_ZONE_JOIN2(a, b)
+#define CPU_ZONE(name) CpuZone CPU_ZONE_JOIN(cpuZone, __LINE__)(name)
+#else
+#define CPU_ZONE(name)
+#endif
+
+//Scoped CPU zones recorded into per-thread buffers and written out as Chrome
+//trace_event JSON (chrome://tracing, Perfetto). Each thread only ever writes its
+//own buffer, the writer publishes events with a release store so WriteTrace can
+//read them from any thread without locking the recording side.
+//Buffers are rings: WriteTrace writes out what was recorded since the last trace,
+//then hands those slots back to the recording thread.
+class CpuProfiler
+{
+public:
+#ifndef CPU_PROFILER_DISABLED
+	static void SetThreadName(const char* name);
+#else
+	static void SetThreadName(const char*) {}
+#endif
+
+	//name must outlive the profiler, use string literals.
+#ifndef CPU_PROFILER_DISABLED
+	static void RecordZone(const char* name, uint64_t start, uint64_t end)
+	{
+		ThreadBuffer* buffer = threadBuffer ? threadBuffer : RegisterThread();
+
+		size_t count = buffer->count.load(memory_order_relaxed);
+		if (count - buffer->written.load(memory_order_acquire) == BUFFER_CAPACITY)
+		{
+			buffer->dropped.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+
+		Event& event = buffer->events[count % BUFFER_CAPACITY];
+		event.name = name;
+		event.start = start;
+		event.end = end;
+		buffer->count.store(count + 1, memory_order_release);
+	}
+#else
+	static void RecordZone(const char*, uint64_t, uint64_t) {}
+#endif
+
+	static uint64_t Now() //Nanoseconds.
+	{
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+#ifndef CPU_PROFILER_DISABLED
+	static bool WriteTrace(const string& fileName);
+#else
+	static bool WriteTrace(const string&) { return true; }
+#endif
+
+private:
+	static const size_t BUFFER_CAPACITY = 1 << 18; //Per thread, about 6 MB.
+
+	struct Event
+	{
+		const char* name;
+		uint64_t start, end;
+	};
+
+	struct ThreadBuffer
+	{
+		Event* events;
+		atomic<size_t> count; //Recorded since the thread started, never wraps.
+		atomic<size_t> written; //How many of those are in a trace, only WriteTrace moves it.
+		atomic<size_t> dropped;
+		unsigned int id;
+		string name;
+	};
+
+	static ThreadBuffer* RegisterThread();
+
+	static thread_local ThreadBuffer* threadBuffer;
+
+	//Buffers outlive their threads so workers that have exited still show up in the trace.
+	static mutex registryMutex;
+	static vector<ThreadBuffer*> buffers;
+};
+
+class CpuZone
+{
+public:
+	CpuZone(const char* zoneName) { name = zoneName; start = CpuProfiler::Now(); }
+	~CpuZone() { CpuProfiler::RecordZone(name, start, CpuProfiler::Now()); }
+
+private:
+	const char* name;
+	uint64_t start;
+};
@@ -10,8 +10,7 @@ public:
 					GLfloat red, GLfloat green, GLfloat blue,
 		GLfloat intensity, GLfloat dIntensity, GLfloat xDir, GLfloat yDir, GLfloat zDir);
 
-	void UseLight(GLfloat ambientIntensityLocation, GLfloat ambientColourLocation,
-		GLfloat diffuseIntensityLocation, GLfloat directionLocation);
+	void WriteBlock(DirectionalLightBlock& block);
 
 	void SetLocationDir(glm::vec3 pos,glm::vec3 dir);
 
@@ -0,0 +1,96 @@
+#include "FrameUniforms.h"
+
+FrameUniforms::FrameUniforms()
+{
+	bufferID = 0;
+	lightsOffset = 0;
+
+	frame = FrameBlock();
+	lights = LightsBlock();
+}
+
+bool FrameUniforms::Init()
+{
+	//As in ClusteredLights::Init, only this function's errors count.
+	while (glGetError() != GL_NO_ERROR) {}
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	lightsOffset = ((sizeof(FrameBlock) + alignment - 1) / alignment) * alignment;
+
+	staging.assign(lightsOffset + sizeof(LightsBlock), 0);
+
+	glGenBuffers(1, &bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, staging.size(), &staging[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	//The binding points never change, programs pick the blocks up through them.
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, bufferID, 0, sizeof(FrameBlock));
+	glBindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, bufferID, lightsOffset, sizeof(LightsBlock));
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR)
+	{
+		printf("Frame uniforms: failed to create the uniform buffer (0x%x)\n", error);
+		return false;
+	}
+
+	return true;
+}
+
+void FrameUniforms::SetCamera(const glm::mat4& projection, const glm::mat4& view, glm::vec3 eyePosition)
+{
+	frame.projection = projection;
+	frame.view = view;
+	frame.eyePosition = eyePosition;
+}
+
+void FrameUniforms::SetLights(DirectionalLight* dLight, PointLight* pLights, unsigned int pointLightCount,
+	SpotLight* sLights, unsigned int spotLightCount)
+{
+	if (pointLightCount > MAX_POINT_LIGHTS) pointLightCount = MAX_POINT_LIGHTS;
+	if (spotLightCount > MAX_SPOT_LIGHTS) spotLightCount = MAX_SPOT_LIGHTS;
+
+	dLight->WriteBlock(lights.directionalLight);
+	frame.directionalLightTransform = dLight->CalculateLightTransform();
+
+	for (unsigned int i = 0; i < pointLightCount; i++)
+	{
+		pLights[i].WriteBlock(lights.pointLights[i]);
+	}
+	for (unsigned int i = 0; i < spotLightCount; i++)
+	{
+		sLights[i].WriteBlock(lights.spotLights[i]);
+	}
+
+	lights.pointLightCount = pointLightCount;
+	lights.spotLightCount = spotLightCount;
+}
+
+void FrameUniforms::Upload()
+{
+	memcpy(&staging[0], &frame, sizeof(frame));
+	memcpy(&staging[lightsOffset], &lights, sizeof(lights));
+
+	//Orphan last frame's copy, then one upload for both blocks.
+	glBindBuffer(GL_UNIFORM_BUFFER, bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, staging.size(), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size(), &staging[0]);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::ClearUniforms()
+{
+	if (bufferID != 0)
+	{
+		glDeleteBuffers(1, &bufferID);
+		bufferID = 0;
+	}
+
+	staging.clear();
+}
+
+FrameUniforms::~FrameUniforms()
+{
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "UniformBlocks.h"
+#include "DirectionalLight.h"
+#include "PointLight.h"
+#include "SpotLight.h"
+
+using namespace std;
+
+//Owns the uniform buffer behind the Frame and Lights blocks. Both blocks live in one
+//buffer, are filled on the CPU and reach the GPU with a single upload per frame.
+class FrameUniforms
+{
+public:
+	FrameUniforms();
+
+	bool Init();
+
+	void SetCamera(const glm::mat4& projection, const glm::mat4& view, glm::vec3 eyePosition);
+	void SetLights(DirectionalLight* dLight, PointLight* pLights, unsigned int pointLightCount,
+		SpotLight* sLights, unsigned int spotLightCount);
+
+	void Upload();
+
+	void ClearUniforms();
+
+	~FrameUniforms();
+
+private:
+	GLuint bufferID;
+	GLsizeiptr lightsOffset; //The Lights block starts at the next offset alignment after Frame.
+
+	FrameBlock frame;
+	LightsBlock lights;
+	vector<unsigned char> staging;
+};
@@ -0,0 +1,121 @@
+#include "Frustum.h"
+
+#include <math.h>
+
+#ifdef FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+Frustum::Frustum()
+{
+	for (int p = 0; p < 6; p++)
+	{
+		planes[p] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+void Frustum::SetFromMatrix(const glm::mat4& viewProjection)
+{
+	//Left/right, bottom/top and near/far are the w row plus and minus the x, y and z rows.
+	glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		planes[i * 2] = w + row;
+		planes[i * 2 + 1] = w - row;
+	}
+
+	//Normalised so plane distances are in world units and compare against radii.
+	for (int p = 0; p < 6; p++)
+	{
+		planes[p] /= glm::length(glm::vec3(planes[p]));
+	}
+}
+
+bool Frustum::TestSphere(glm::vec3 center, GLfloat radius) const
+{
+	for (int p = 0; p < 6; p++)
+	{
+		if (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Frustum::TestBox(glm::vec3 minimum, glm::vec3 maximum, const glm::mat4& transform) const
+{
+	//Transform the box's centre, and its extents onto the world axes.
+	glm::vec3 center = glm::vec3(transform * glm::vec4((minimum + maximum) * 0.5f, 1.0f));
+	glm::vec3 half = (maximum - minimum) * 0.5f;
+	glm::vec3 extent;
+	for (int i = 0; i < 3; i++)
+	{
+		extent[i] = fabsf(transform[0][i]) * half.x + fabsf(transform[1][i]) * half.y + fabsf(transform[2][i]) * half.z;
+	}
+
+	for (int p = 0; p < 6; p++)
+	{
+		glm::vec3 normal(planes[p]);
+		GLfloat reach = fabsf(normal.x) * extent.x + fabsf(normal.y) * extent.y + fabsf(normal.z) * extent.z;
+		if (glm::dot(normal, center) + planes[p].w < -reach)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Frustum::TestSpheres(const glm::vec4* spheres, size_t count, unsigned char* visible) const
+{
+	size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(planes[p].x);
+		planeY[p] = _mm_set1_ps(planes[p].y);
+		planeZ[p] = _mm_set1_ps(planes[p].z);
+		planeW[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		//Four (x, y, z, r) spheres become x, y, z and r lanes.
+		__m128 x = _mm_loadu_ps(&spheres[i].x);
+		__m128 y = _mm_loadu_ps(&spheres[i + 1].x);
+		__m128 z = _mm_loadu_ps(&spheres[i + 2].x);
+		__m128 r = _mm_loadu_ps(&spheres[i + 3].x);
+		_MM_TRANSPOSE4_PS(x, y, z, r);
+
+		__m128 negativeRadius = _mm_sub_ps(zero, r);
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		visible[i] = mask & 1;
+		visible[i + 1] = (mask >> 1) & 1;
+		visible[i + 2] = (mask >> 2) & 1;
+		visible[i + 3] = (mask >> 3) & 1;
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		visible[i] = TestSphere(glm::vec3(spheres[i]), spheres[i].w) ? 1 : 0;
+	}
+}
+
+Frustum::~Frustum()
+{
+}
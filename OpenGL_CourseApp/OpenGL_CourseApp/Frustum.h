@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE
+#endif
+
+//Six planes pulled out of a view-projection matrix, normals pointing inwards.
+class Frustum
+{
+public:
+	Frustum();
+
+	void SetFromMatrix(const glm::mat4& viewProjection);
+
+	bool TestSphere(glm::vec3 center, GLfloat radius) const;
+	bool TestBox(glm::vec3 minimum, glm::vec3 maximum, const glm::mat4& transform) const; //Model-space box.
+
+	//Spheres are (x, y, z, radius). Writes 1 for each sphere touching the frustum, 0 otherwise.
+	//Four spheres are tested per step with SSE where it is available.
+	void TestSpheres(const glm::vec4* spheres, size_t count, unsigned char* visible) const;
+
+	~Frustum();
+
+private:
+	glm::vec4 planes[6];
+};
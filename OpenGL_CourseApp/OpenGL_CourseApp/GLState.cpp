@@ -0,0 +1,258 @@
+#include "GLState.h"
+
+//Not a valid name, forces the next bind through after a Forget.
+static const GLuint UNKNOWN_NAME = 0xFFFFFFFFu;
+
+GLuint GLState::currentProgram = 0;
+GLuint GLState::currentVertexArray = 0;
+GLenum GLState::activeUnit = GL_TEXTURE0;
+GLuint GLState::boundTextures[GLState::MAX_TEXTURE_UNITS][GLState::TEXTURE_TARGET_COUNT] = {};
+
+unordered_map<uint64_t, GLState::UniformValue> GLState::uniformValues;
+
+GLState::CallCounts GLState::frameCounts = {};
+GLState::CallCounts GLState::lastFrameCounts = {};
+unsigned int GLState::frames = 0;
+
+static const char* callNames[GLState::STATE_CALL_COUNT] =
+{
+	"Program", "Vertex array", "Active texture", "Texture", "Uniform", "Validate"
+};
+
+void GLState::UseProgram(GLuint program)
+{
+	if (program == currentProgram)
+	{
+		Record(STATE_PROGRAM, false);
+		return;
+	}
+
+	glUseProgram(program);
+	currentProgram = program;
+	Record(STATE_PROGRAM, true);
+}
+
+void GLState::BindVertexArray(GLuint vertexArray)
+{
+	if (vertexArray == currentVertexArray)
+	{
+		Record(STATE_VERTEX_ARRAY, false);
+		return;
+	}
+
+	glBindVertexArray(vertexArray);
+	currentVertexArray = vertexArray;
+	Record(STATE_VERTEX_ARRAY, true);
+}
+
+void GLState::ActiveTexture(GLenum unit)
+{
+	if (unit == activeUnit)
+	{
+		Record(STATE_ACTIVE_TEXTURE, false);
+		return;
+	}
+
+	glActiveTexture(unit);
+	activeUnit = unit;
+	Record(STATE_ACTIVE_TEXTURE, true);
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+	unsigned int unit = activeUnit - GL_TEXTURE0;
+	int targetIndex = TargetIndex(target);
+
+	//Units and targets outside the table are never cached.
+	if (unit >= MAX_TEXTURE_UNITS || targetIndex < 0)
+	{
+		glBindTexture(target, texture);
+		Record(STATE_TEXTURE, true);
+		return;
+	}
+
+	if (boundTextures[unit][targetIndex] == texture)
+	{
+		Record(STATE_TEXTURE, false);
+		return;
+	}
+
+	glBindTexture(target, texture);
+	boundTextures[unit][targetIndex] = texture;
+	Record(STATE_TEXTURE, true);
+}
+
+void GLState::BindTexture(GLenum unit, GLenum target, GLuint texture)
+{
+	unsigned int unitIndex = unit - GL_TEXTURE0;
+	int targetIndex = TargetIndex(target);
+
+	//Already bound there, the active unit does not need to move either.
+	if (unitIndex < MAX_TEXTURE_UNITS && targetIndex >= 0 && boundTextures[unitIndex][targetIndex] == texture)
+	{
+		Record(STATE_ACTIVE_TEXTURE, false);
+		Record(STATE_TEXTURE, false);
+		return;
+	}
+
+	ActiveTexture(unit);
+	BindTexture(target, texture);
+}
+
+void GLState::Uniform1i(GLint location, GLint value)
+{
+	if (UniformChanged(location, &value, 1))
+	{
+		glUniform1i(location, value);
+	}
+}
+
+void GLState::Uniform1f(GLint location, GLfloat value)
+{
+	if (UniformChanged(location, &value, 1))
+	{
+		glUniform1f(location, value);
+	}
+}
+
+void GLState::Uniform2f(GLint location, GLfloat x, GLfloat y)
+{
+	GLfloat values[2] = { x, y };
+	if (UniformChanged(location, values, 2))
+	{
+		glUniform2f(location, x, y);
+	}
+}
+
+void GLState::Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+	GLfloat values[3] = { x, y, z };
+	if (UniformChanged(location, values, 3))
+	{
+		glUniform3f(location, x, y, z);
+	}
+}
+
+void GLState::UniformMatrix4fv(GLint location, const GLfloat* value)
+{
+	if (UniformChanged(location, value, 16))
+	{
+		glUniformMatrix4fv(location, 1, GL_FALSE, value);
+	}
+}
+
+bool GLState::UniformChanged(GLint location, const void* values, unsigned int count)
+{
+	//Inactive uniform, GL would ignore the write anyway.
+	if (location < 0)
+	{
+		return false;
+	}
+
+	uint64_t key = ((uint64_t)currentProgram << 32) | (uint32_t)location;
+	unordered_map<uint64_t, UniformValue>::iterator cached = uniformValues.find(key);
+	if (cached != uniformValues.end() && cached->second.count == count &&
+		memcmp(cached->second.bits, values, sizeof(uint32_t) * count) == 0)
+	{
+		Record(STATE_UNIFORM, false);
+		return false;
+	}
+
+	UniformValue& value = uniformValues[key];
+	memcpy(value.bits, values, sizeof(uint32_t) * count);
+	value.count = count;
+	Record(STATE_UNIFORM, true);
+	return true;
+}
+
+void GLState::ForgetProgram(GLuint program)
+{
+	for (unordered_map<uint64_t, UniformValue>::iterator it = uniformValues.begin(); it != uniformValues.end();)
+	{
+		if ((GLuint)(it->first >> 32) == program)
+		{
+			it = uniformValues.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	if (currentProgram == program)
+	{
+		currentProgram = UNKNOWN_NAME;
+	}
+}
+
+void GLState::ForgetVertexArray(GLuint vertexArray)
+{
+	//Deleting the bound VAO reverts GL to 0.
+	if (currentVertexArray == vertexArray)
+	{
+		currentVertexArray = 0;
+	}
+}
+
+void GLState::ForgetTexture(GLuint texture)
+{
+	//Deleted textures are unbound from every unit, the name may come back from glGenTextures.
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		for (unsigned int target = 0; target < TEXTURE_TARGET_COUNT; target++)
+		{
+			if (boundTextures[unit][target] == texture)
+			{
+				boundTextures[unit][target] = 0;
+			}
+		}
+	}
+}
+
+int GLState::TargetIndex(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_CUBE_MAP: return 2;
+	case GL_TEXTURE_BUFFER: return 3;
+	default: return -1;
+	}
+}
+
+void GLState::Record(StateCall call, bool issued)
+{
+	if (issued)
+	{
+		frameCounts.issued[call]++;
+	}
+	else
+	{
+		frameCounts.elided[call]++;
+	}
+}
+
+void GLState::EndFrame()
+{
+	lastFrameCounts = frameCounts;
+	frameCounts = CallCounts();
+	frames++;
+}
+
+void GLState::Print()
+{
+	printf("GL state calls, frame %u:\n", frames);
+
+	unsigned int totalIssued = 0, totalElided = 0;
+	for (unsigned int i = 0; i < STATE_CALL_COUNT; i++)
+	{
+		printf("  %-16s %6u issued, %6u elided\n", callNames[i], lastFrameCounts.issued[i], lastFrameCounts.elided[i]);
+		totalIssued += lastFrameCounts.issued[i];
+		totalElided += lastFrameCounts.elided[i];
+	}
+
+	unsigned int total = totalIssued + totalElided;
+	printf("  %-16s %6u issued, %6u elided (%.1f%%)\n", "Total", totalIssued, totalElided,
+		total > 0 ? 100.0 * totalElided / total : 0.0);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unordered_map>
+
+#include <GL\glew.h>
+
+using namespace std;
+
+//Shadow copy of the GL state the renderer touches every draw. Binds and uniform
+//writes that would not change anything are skipped, and both the issued and the
+//elided calls are counted per frame.
+//Everything that binds programs, VAOs or textures has to go through here, and
+//anything that deletes one has to Forget it, or the copy goes stale.
+class GLState
+{
+public:
+	enum StateCall
+	{
+		STATE_PROGRAM,
+		STATE_VERTEX_ARRAY,
+		STATE_ACTIVE_TEXTURE,
+		STATE_TEXTURE,
+		STATE_UNIFORM,
+		STATE_VALIDATE,
+		STATE_CALL_COUNT
+	};
+
+	static void UseProgram(GLuint program);
+	static GLuint GetProgram() { return currentProgram; }
+	static void BindVertexArray(GLuint vertexArray);
+
+	static void ActiveTexture(GLenum unit); //GL_TEXTURE0 + n, as glActiveTexture.
+	static void BindTexture(GLenum target, GLuint texture); //On the active unit.
+	static void BindTexture(GLenum unit, GLenum target, GLuint texture);
+
+	//Cached per program and location, so they only apply to the program in use.
+	static void Uniform1i(GLint location, GLint value);
+	static void Uniform1f(GLint location, GLfloat value);
+	static void Uniform2f(GLint location, GLfloat x, GLfloat y);
+	static void Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z);
+	static void UniformMatrix4fv(GLint location, const GLfloat* value);
+
+	static void ForgetProgram(GLuint program); //Deleted or relinked.
+	static void ForgetVertexArray(GLuint vertexArray);
+	static void ForgetTexture(GLuint texture);
+
+	//For calls made outside this class, e.g. Shader::Validate.
+	static void Record(StateCall call, bool issued);
+
+	static void EndFrame(); //Keeps this frame's counts for Print and starts the next.
+	static void Print();
+
+private:
+	static const unsigned int MAX_TEXTURE_UNITS = 32;
+	static const unsigned int TEXTURE_TARGET_COUNT = 4;
+
+	struct UniformValue
+	{
+		uint32_t bits[16]; //Raw bits, so ints and floats compare the same way.
+		unsigned int count;
+	};
+
+	struct CallCounts
+	{
+		unsigned int issued[STATE_CALL_COUNT];
+		unsigned int elided[STATE_CALL_COUNT];
+	};
+
+	static int TargetIndex(GLenum target);
+	static bool UniformChanged(GLint location, const void* values, unsigned int count);
+
+	static GLuint currentProgram;
+	static GLuint currentVertexArray;
+	static GLenum activeUnit;
+	static GLuint boundTextures[MAX_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+
+	static unordered_map<uint64_t, UniformValue> uniformValues;
+
+	static CallCounts frameCounts, lastFrameCounts;
+	static unsigned int frames;
+};
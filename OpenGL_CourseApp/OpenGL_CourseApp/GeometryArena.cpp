@@ -0,0 +1,322 @@
+#include "GeometryArena.h"
+
+GLuint GeometryArena::vertexArray = 0;
+GLuint GeometryArena::vertexBuffer = 0;
+GLuint GeometryArena::indexBuffer = 0;
+GLuint GeometryArena::vertexCapacity = 0;
+GLuint GeometryArena::indexCapacity = 0;
+GLuint GeometryArena::verticesUsed = 0;
+GLuint GeometryArena::indicesUsed = 0;
+vector<GeometryArena::Range> GeometryArena::freeVertices;
+vector<GeometryArena::Range> GeometryArena::freeIndices;
+
+GLuint GeometryArena::attachedInstanceBuffer = 0;
+GLuint GeometryArena::attachedLayerBuffer = 0;
+GLuint GeometryArena::instanceDivisor = 1;
+
+bool GeometryArena::Allocate(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount,
+	Allocation& allocation)
+{
+	if (vertexArray == 0 && !Create())
+	{
+		return false;
+	}
+
+	GLuint vertexOffset = 0, indexOffset = 0;
+
+	//The element buffer binding belongs to the VAO, keep ours bound while touching it.
+	Bind();
+
+	if (!AllocateRange(freeVertices, vertexCount, vertexOffset))
+	{
+		if (!Grow(vertexBuffer, GL_ARRAY_BUFFER, vertexCapacity, vertexCount, sizeof(PackedVertex), freeVertices) ||
+			!AllocateRange(freeVertices, vertexCount, vertexOffset))
+		{
+			printf("Geometry arena could not fit %u vertices\n", vertexCount);
+			return false;
+		}
+	}
+
+	if (!AllocateRange(freeIndices, indexCount, indexOffset))
+	{
+		if (!Grow(indexBuffer, GL_ELEMENT_ARRAY_BUFFER, indexCapacity, indexCount, sizeof(PackedIndex), freeIndices) ||
+			!AllocateRange(freeIndices, indexCount, indexOffset))
+		{
+			printf("Geometry arena could not fit %u indices\n", indexCount);
+			FreeRange(freeVertices, vertexOffset, vertexCount);
+			return false;
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * vertexOffset, sizeof(PackedVertex) * vertexCount, vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(PackedIndex) * indexOffset, sizeof(PackedIndex) * indexCount, indices);
+
+	allocation.baseVertex = vertexOffset;
+	allocation.firstIndex = indexOffset;
+	allocation.vertexCount = vertexCount;
+	allocation.indexCount = indexCount;
+
+	verticesUsed += vertexCount;
+	indicesUsed += indexCount;
+
+	return true;
+}
+
+void GeometryArena::Free(const Allocation& allocation)
+{
+	//Meshes outliving Clear have nothing left to give back.
+	if (vertexArray == 0)
+	{
+		return;
+	}
+
+	FreeRange(freeVertices, allocation.baseVertex, allocation.vertexCount);
+	FreeRange(freeIndices, allocation.firstIndex, allocation.indexCount);
+
+	verticesUsed -= allocation.vertexCount;
+	indicesUsed -= allocation.indexCount;
+}
+
+void GeometryArena::Bind()
+{
+	GLState::BindVertexArray(vertexArray);
+}
+
+void GeometryArena::AttachInstanceBuffers(GLuint instanceBuffer, GLuint layerBuffer)
+{
+	Bind();
+
+	if (attachedInstanceBuffer != instanceBuffer)
+	{
+		//Per-instance model matrix, one vec4 column per attribute (locations 3-6).
+		glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+		for (GLuint i = 0; i < 4; i++)
+		{
+			glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 16, (void*)(sizeof(GLfloat) * 4 * i));
+			glEnableVertexAttribArray(3 + i);
+			glVertexAttribDivisor(3 + i, instanceDivisor);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		attachedInstanceBuffer = instanceBuffer;
+	}
+
+	if (attachedLayerBuffer != layerBuffer)
+	{
+		//Per-instance texture array layer (location 7).
+		if (layerBuffer == 0)
+		{
+			glDisableVertexAttribArray(7);
+		}
+		else
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, layerBuffer);
+			glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat), 0);
+			glEnableVertexAttribArray(7);
+			glVertexAttribDivisor(7, instanceDivisor);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		attachedLayerBuffer = layerBuffer;
+	}
+}
+
+void GeometryArena::SetInstanceDivisor(GLuint divisor)
+{
+	if (instanceDivisor == divisor)
+	{
+		return;
+	}
+
+	Bind();
+	for (GLuint i = 3; i <= 7; i++)
+	{
+		glVertexAttribDivisor(i, divisor);
+	}
+
+	instanceDivisor = divisor;
+}
+
+void GeometryArena::DetachInstanceBuffers()
+{
+	if (vertexArray == 0)
+	{
+		return;
+	}
+
+	Bind();
+	for (GLuint i = 3; i <= 7; i++)
+	{
+		glDisableVertexAttribArray(i);
+	}
+
+	attachedInstanceBuffer = attachedLayerBuffer = 0;
+}
+
+bool GeometryArena::IsIndirectSupported()
+{
+	return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && (GLEW_VERSION_4_2 || GLEW_ARB_base_instance));
+}
+
+void GeometryArena::PrintStats()
+{
+	printf("Geometry arena: %u/%u vertices, %u/%u indices, %.1f MB\n", verticesUsed, vertexCapacity, indicesUsed, indexCapacity,
+		(sizeof(PackedVertex) * vertexCapacity + sizeof(PackedIndex) * indexCapacity) / (1024.0 * 1024.0));
+}
+
+void GeometryArena::Clear()
+{
+	if (vertexArray != 0)
+	{
+		GLState::ForgetVertexArray(vertexArray);
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteBuffers(1, &vertexBuffer);
+		glDeleteBuffers(1, &indexBuffer);
+	}
+
+	vertexArray = vertexBuffer = indexBuffer = 0;
+	vertexCapacity = indexCapacity = 0;
+	verticesUsed = indicesUsed = 0;
+	freeVertices.clear();
+	freeIndices.clear();
+
+	attachedInstanceBuffer = attachedLayerBuffer = 0;
+	instanceDivisor = 1;
+}
+
+bool GeometryArena::Create()
+{
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &vertexBuffer);
+	glGenBuffers(1, &indexBuffer);
+	if (vertexArray == 0 || vertexBuffer == 0 || indexBuffer == 0)
+	{
+		printf("Failed to create the geometry arena\n");
+		return false;
+	}
+
+	vertexCapacity = INITIAL_VERTICES;
+	indexCapacity = INITIAL_INDICES;
+
+	Bind();
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(PackedIndex) * indexCapacity, nullptr, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * vertexCapacity, nullptr, GL_STATIC_DRAW);
+	SetVertexFormat();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	Range vertexRange = { 0, vertexCapacity };
+	Range indexRange = { 0, indexCapacity };
+	freeVertices.assign(1, vertexRange);
+	freeIndices.assign(1, indexRange);
+
+	return true;
+}
+
+bool GeometryArena::Grow(GLuint& buffer, GLenum target, GLuint& capacity, GLuint needed, GLuint elementSize, vector<Range>& freeRanges)
+{
+	GLuint newCapacity = capacity * 2;
+	while (newCapacity < capacity + needed)
+	{
+		newCapacity *= 2;
+	}
+
+	GLuint newBuffer = 0;
+	glGenBuffers(1, &newBuffer);
+	if (newBuffer == 0)
+	{
+		return false;
+	}
+
+	//The copy targets leave the VAO's bindings alone.
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)elementSize * newCapacity, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)elementSize * capacity);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	//Point the VAO at the new buffer before the old one goes.
+	Bind();
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, newBuffer);
+	}
+	else
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, newBuffer);
+		SetVertexFormat();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glDeleteBuffers(1, &buffer);
+	buffer = newBuffer;
+
+	FreeRange(freeRanges, capacity, newCapacity - capacity);
+	capacity = newCapacity;
+
+	return true;
+}
+
+void GeometryArena::SetVertexFormat()
+{
+	//Half-float position and texture coordinates, octahedral normal.
+	ApplyVertexLayout<PackedVertex>();
+}
+
+bool GeometryArena::AllocateRange(vector<Range>& freeRanges, GLuint count, GLuint& offset)
+{
+	for (size_t i = 0; i < freeRanges.size(); i++)
+	{
+		if (freeRanges[i].count >= count)
+		{
+			offset = freeRanges[i].offset;
+			freeRanges[i].offset += count;
+			freeRanges[i].count -= count;
+			if (freeRanges[i].count == 0)
+			{
+				freeRanges.erase(freeRanges.begin() + i);
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void GeometryArena::FreeRange(vector<Range>& freeRanges, GLuint offset, GLuint count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	size_t i = 0;
+	while (i < freeRanges.size() && freeRanges[i].offset < offset)
+	{
+		i++;
+	}
+
+	Range range = { offset, count };
+	freeRanges.insert(freeRanges.begin() + i, range);
+
+	//Merge with the next range, then with the previous one.
+	if (i + 1 < freeRanges.size() && freeRanges[i].offset + freeRanges[i].count == freeRanges[i + 1].offset)
+	{
+		freeRanges[i].count += freeRanges[i + 1].count;
+		freeRanges.erase(freeRanges.begin() + i + 1);
+	}
+
+	if (i > 0 && freeRanges[i - 1].offset + freeRanges[i - 1].count == freeRanges[i].offset)
+	{
+		freeRanges[i - 1].count += freeRanges[i].count;
+		freeRanges.erase(freeRanges.begin() + i);
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "GLState.h"
+#include "VertexLayout.h"
+
+using namespace std;
+
+//One vertex buffer, one index buffer and one VAO shared by every mesh. Meshes get a
+//range of each and draw with a base vertex, so switching meshes never switches VAOs,
+//and a whole pass can go out as one glMultiDrawElementsIndirect where it is supported.
+//Both buffers double when they run out, moving the existing ranges along.
+class GeometryArena
+{
+public:
+	//Offsets and counts in vertices and indices, not bytes.
+	struct Allocation
+	{
+		GLint baseVertex;
+		GLuint firstIndex;
+		GLuint vertexCount;
+		GLuint indexCount;
+	};
+
+	//Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER.
+	struct IndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	//Every mesh shares the packed layout and 16-bit indices, so draws pass INDEX_TYPE.
+	static const GLenum INDEX_TYPE = GL_UNSIGNED_SHORT;
+
+	static bool Allocate(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount,
+		Allocation& allocation);
+	static void Free(const Allocation& allocation);
+
+	static void Bind();
+
+	//Per-instance model matrices (locations 3-6) and texture layers (7) on the shared VAO.
+	static void AttachInstanceBuffers(GLuint instanceBuffer, GLuint layerBuffer);
+	static void SetInstanceDivisor(GLuint divisor);
+	static void DetachInstanceBuffers(); //Before the attached buffers are deleted, their names may come back.
+
+	//GL 4.3, or the multi_draw_indirect and base_instance extensions.
+	static bool IsIndirectSupported();
+
+	static void PrintStats();
+	static void Clear();
+
+private:
+	static const GLuint INITIAL_VERTICES = 1 << 18;
+	static const GLuint INITIAL_INDICES = 1 << 20;
+
+	struct Range
+	{
+		GLuint offset, count;
+	};
+
+	static bool Create();
+	static bool Grow(GLuint& buffer, GLenum target, GLuint& capacity, GLuint needed, GLuint elementSize, vector<Range>& freeRanges);
+	static void SetVertexFormat();
+
+	//First fit over free ranges kept sorted by offset, neighbours merge again on free.
+	static bool AllocateRange(vector<Range>& freeRanges, GLuint count, GLuint& offset);
+	static void FreeRange(vector<Range>& freeRanges, GLuint offset, GLuint count);
+
+	static GLuint vertexArray, vertexBuffer, indexBuffer;
+	static GLuint vertexCapacity, indexCapacity;
+	static GLuint verticesUsed, indicesUsed;
+	static vector<Range> freeVertices, freeIndices;
+
+	static GLuint attachedInstanceBuffer, attachedLayerBuffer;
+	static GLuint instanceDivisor;
+};
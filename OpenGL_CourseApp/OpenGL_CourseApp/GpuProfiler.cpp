@@ -0,0 +1,237 @@
+#include "GpuProfiler.h"
+
+bool GpuProfiler::enabled = true;
+bool GpuProfiler::supported = false;
+bool GpuProfiler::checked = false;
+
+GpuProfiler::FrameQueries GpuProfiler::frames[FRAME_LATENCY];
+unsigned int GpuProfiler::frameIndex = 0;
+vector<size_t> GpuProfiler::openScopes;
+
+vector<string> GpuProfiler::scopePaths;
+unordered_map<string, int> GpuProfiler::scopeIds;
+vector<GpuProfiler::ScopeStats> GpuProfiler::stats;
+
+unsigned int GpuProfiler::resolvedFrames = 0;
+unsigned int GpuProfiler::droppedFrames = 0;
+
+void GpuProfiler::BeginFrame()
+{
+	if (!checked)
+	{
+		supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+		checked = true;
+	}
+
+	if (!enabled || !supported)
+	{
+		return;
+	}
+
+	frameIndex++;
+
+	//This slot was last used FRAME_LATENCY frames ago, harvest it before reuse.
+	FrameQueries& frame = frames[frameIndex % FRAME_LATENCY];
+	if (frame.used > 0)
+	{
+		Resolve(frame);
+	}
+
+	frame.used = 0;
+	openScopes.clear();
+
+	BeginScope("Frame");
+}
+
+void GpuProfiler::EndFrame()
+{
+	if (!enabled || !supported)
+	{
+		return;
+	}
+
+	//Close anything left open, including the root scope.
+	while (!openScopes.empty())
+	{
+		EndScope();
+	}
+}
+
+void GpuProfiler::BeginScope(const char* name)
+{
+	if (!enabled || !supported || frameIndex == 0)
+	{
+		return;
+	}
+
+	FrameQueries& frame = frames[frameIndex % FRAME_LATENCY];
+
+	string path = name;
+	if (!openScopes.empty())
+	{
+		path = scopePaths[frame.queries[openScopes.back()].scope] + "/" + path;
+	}
+
+	if (frame.used == frame.queries.size())
+	{
+		ScopeQuery query;
+		glGenQueries(1, &query.begin);
+		glGenQueries(1, &query.end);
+		frame.queries.push_back(query);
+	}
+
+	ScopeQuery& query = frame.queries[frame.used];
+	query.scope = FindScope(path, openScopes.size());
+
+	glQueryCounter(query.begin, GL_TIMESTAMP);
+
+	openScopes.push_back(frame.used);
+	frame.used++;
+}
+
+void GpuProfiler::EndScope()
+{
+	if (!enabled || !supported || openScopes.empty())
+	{
+		return;
+	}
+
+	FrameQueries& frame = frames[frameIndex % FRAME_LATENCY];
+
+	glQueryCounter(frame.queries[openScopes.back()].end, GL_TIMESTAMP);
+	openScopes.pop_back();
+}
+
+int GpuProfiler::FindScope(const string& path, unsigned int depth)
+{
+	auto found = scopeIds.find(path);
+	if (found != scopeIds.end())
+	{
+		return found->second;
+	}
+
+	ScopeStats scope;
+	scope.sum = 0.0;
+	scope.last = 0.0;
+	scope.depth = depth;
+
+	scopeIds[path] = scopePaths.size();
+	scopePaths.push_back(path);
+	stats.push_back(scope);
+
+	return scopePaths.size() - 1;
+}
+
+void GpuProfiler::Resolve(FrameQueries& frame)
+{
+	//Queries finish in order, so the root's end being ready means they all are.
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[0].end, GL_QUERY_RESULT_AVAILABLE, &available);
+
+	if (!available)
+	{
+		droppedFrames++;
+		return;
+	}
+
+	//A scope entered more than once in a frame (same path) reports the sum.
+	vector<double> totals(stats.size(), -1.0);
+
+	for (size_t i = 0; i < frame.used; i++)
+	{
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(frame.queries[i].begin, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[i].end, GL_QUERY_RESULT, &end);
+
+		double& total = totals[frame.queries[i].scope];
+		total = (total < 0.0 ? 0.0 : total) + (end - begin) / 1000000.0;
+	}
+
+	for (size_t i = 0; i < totals.size(); i++)
+	{
+		if (totals[i] < 0.0)
+		{
+			continue;
+		}
+
+		ScopeStats& scope = stats[i];
+		scope.last = totals[i];
+		scope.samples.push_back(totals[i]);
+		scope.sum += totals[i];
+
+		if (scope.samples.size() > AVERAGE_FRAMES)
+		{
+			scope.sum -= scope.samples.front();
+			scope.samples.pop_front();
+		}
+	}
+
+	resolvedFrames++;
+}
+
+double GpuProfiler::GetAverage(const string& path)
+{
+	auto found = scopeIds.find(path);
+	if (found == scopeIds.end() || stats[found->second].samples.empty())
+	{
+		return 0.0;
+	}
+
+	return stats[found->second].sum / stats[found->second].samples.size();
+}
+
+double GpuProfiler::GetLast(const string& path)
+{
+	auto found = scopeIds.find(path);
+	return found == scopeIds.end() ? 0.0 : stats[found->second].last;
+}
+
+void GpuProfiler::Print()
+{
+	if (!supported)
+	{
+		printf("GPU profiler: timer queries are not supported\n");
+		return;
+	}
+
+	printf("GPU profile, average of the last %u frames (%u resolved, %u dropped):\n", AVERAGE_FRAMES, resolvedFrames, droppedFrames);
+
+	for (size_t i = 0; i < scopePaths.size(); i++)
+	{
+		const ScopeStats& scope = stats[i];
+		if (scope.samples.empty())
+		{
+			continue;
+		}
+
+		const string& path = scopePaths[i];
+		string name = path.substr(path.rfind('/') == string::npos ? 0 : path.rfind('/') + 1);
+
+		printf("%*s%-*s %8.3f ms\n", scope.depth * 2 + 2, "", 32 - scope.depth * 2, name.c_str(), scope.sum / scope.samples.size());
+	}
+}
+
+void GpuProfiler::Clear()
+{
+	for (size_t f = 0; f < FRAME_LATENCY; f++)
+	{
+		for (size_t i = 0; i < frames[f].queries.size(); i++)
+		{
+			glDeleteQueries(1, &frames[f].queries[i].begin);
+			glDeleteQueries(1, &frames[f].queries[i].end);
+		}
+
+		frames[f].queries.clear();
+		frames[f].used = 0;
+	}
+
+	frameIndex = 0;
+	openScopes.clear();
+
+	scopePaths.clear();
+	scopeIds.clear();
+	stats.clear();
+
+	resolvedFrames = 0;
+	droppedFrames = 0;
+}
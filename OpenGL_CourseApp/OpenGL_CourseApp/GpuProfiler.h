@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+#include <GL\glew.h>
+
+using namespace std;
+
+//GPU timings per named scope, taken with GL_TIMESTAMP queries so scopes can nest.
+//Each frame uses its own set of queries out of a ring FRAME_LATENCY frames deep,
+//and results are only read once they are available, so the CPU never waits on them.
+class GpuProfiler
+{
+public:
+	static void BeginFrame(); //Opens the root "Frame" scope.
+	static void EndFrame();
+
+	static void BeginScope(const char* name);
+	static void EndScope();
+
+	//Scope paths look like "Frame/Omni shadows/Point light 0".
+	static const vector<string>& GetScopePaths() { return scopePaths; }
+	static double GetAverage(const string& path); //Milliseconds over the last AVERAGE_FRAMES resolved frames.
+	static double GetLast(const string& path);
+
+	static void Print();
+
+	static void SetEnabled(bool enable) { enabled = enable; }
+	static bool IsEnabled() { return enabled; }
+
+	static void Clear();
+
+private:
+	static const unsigned int FRAME_LATENCY = 4;
+	static const unsigned int AVERAGE_FRAMES = 60;
+
+	struct ScopeQuery
+	{
+		int scope;
+		GLuint begin, end;
+	};
+
+	struct FrameQueries
+	{
+		vector<ScopeQuery> queries;
+		size_t used;
+	};
+
+	struct ScopeStats
+	{
+		deque<double> samples;
+		double sum;
+		double last;
+		unsigned int depth;
+	};
+
+	static int FindScope(const string& path, unsigned int depth);
+	static void Resolve(FrameQueries& frame);
+
+	static bool enabled, supported, checked;
+
+	static FrameQueries frames[FRAME_LATENCY];
+	static unsigned int frameIndex;
+	static vector<size_t> openScopes; //Indices into the current frame's queries.
+
+	static vector<string> scopePaths;
+	static unordered_map<string, int> scopeIds;
+	static vector<ScopeStats> stats;
+
+	static unsigned int resolvedFrames, droppedFrames;
+};
+
+//Times everything until the end of the enclosing block.
+class GpuScope
+{
+public:
+	GpuScope(const char* name) { GpuProfiler::BeginScope(name); }
+	~GpuScope() { GpuProfiler::EndScope(); }
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//64-bit FNV-1a, chain calls by passing the previous result as the seed.
+const uint64_t HASH_SEED = 14695981039346656037ULL;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HASH_SEED)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+
+	return hash;
+}
@@ -0,0 +1,208 @@
+#include "KtxFile.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct KtxHeader
+{
+	unsigned char identifier[12];
+	uint32_t endianness;
+	uint32_t glType;
+	uint32_t glTypeSize;
+	uint32_t glFormat;
+	uint32_t glInternalFormat;
+	uint32_t glBaseInternalFormat;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t numberOfArrayElements;
+	uint32_t numberOfFaces;
+	uint32_t numberOfMipmapLevels;
+	uint32_t bytesOfKeyValueData;
+};
+
+KtxFile::KtxFile()
+{
+	internalFormat = 0;
+	width = 0;
+	height = 0;
+	levelCount = 0;
+	faceCount = 0;
+}
+
+bool KtxFile::Load(const string& fileName)
+{
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if (size < (long)sizeof(KtxHeader))
+	{
+		fclose(file);
+		return false;
+	}
+
+	data.resize(size);
+	bool read = fread(&data[0], 1, size, file) == (size_t)size;
+	fclose(file);
+
+	KtxHeader header;
+	memcpy(&header, &data[0], sizeof(header));
+
+	//Only little-endian, block-compressed 2D textures and cube maps come out of the cooker.
+	if (!read || memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) != 0 || header.endianness != 0x04030201
+		|| header.glType != 0 || header.pixelDepth != 0 || header.numberOfArrayElements != 0
+		|| (header.numberOfFaces != 1 && header.numberOfFaces != 6))
+	{
+		printf("Unsupported KTX file: %s\n", fileName.c_str());
+		return false;
+	}
+
+	switch (header.glInternalFormat)
+	{
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+		break;
+	default:
+		printf("Unsupported KTX format 0x%04X: %s\n", header.glInternalFormat, fileName.c_str());
+		return false;
+	}
+
+	internalFormat = header.glInternalFormat;
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+	levelCount = header.numberOfMipmapLevels > 0 ? header.numberOfMipmapLevels : 1;
+	faceCount = header.numberOfFaces;
+
+	size_t offset = sizeof(KtxHeader) + header.bytesOfKeyValueData;
+	for (GLuint level = 0; level < levelCount; level++)
+	{
+		if (offset + sizeof(uint32_t) > data.size())
+		{
+			printf("Truncated KTX file: %s\n", fileName.c_str());
+			return false;
+		}
+
+		uint32_t imageSize;
+		memcpy(&imageSize, &data[offset], sizeof(imageSize));
+		offset += sizeof(uint32_t);
+
+		//Faces and levels are padded to 4 bytes, which compressed blocks already are.
+		size_t faceStride = (imageSize + 3) & ~3u;
+		if (offset + faceStride * faceCount > data.size())
+		{
+			printf("Truncated KTX file: %s\n", fileName.c_str());
+			return false;
+		}
+
+		levelOffset.push_back(offset);
+		levelSize.push_back(imageSize);
+		offset += faceStride * faceCount;
+	}
+
+	return true;
+}
+
+bool KtxFile::IsCompatible(const KtxFile& other) const
+{
+	return internalFormat == other.internalFormat && width == other.width && height == other.height
+		&& levelCount == other.levelCount && faceCount == other.faceCount;
+}
+
+void KtxFile::UploadImage(GLenum target, GLuint face) const
+{
+	for (GLuint level = 0; level < levelCount; level++)
+	{
+		size_t faceStride = (levelSize[level] + 3) & ~3u;
+		glCompressedTexImage2D(target, level, internalFormat, GetLevelDimension(width, level), GetLevelDimension(height, level),
+			0, levelSize[level], &data[levelOffset[level] + faceStride * face]);
+	}
+}
+
+void KtxFile::AllocateArray(GLsizei layers) const
+{
+	for (GLuint level = 0; level < levelCount; level++)
+	{
+		glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, GetLevelDimension(width, level), GetLevelDimension(height, level),
+			layers, 0, levelSize[level] * layers, nullptr);
+	}
+}
+
+void KtxFile::UploadLayer(GLint layer) const
+{
+	for (GLuint level = 0; level < levelCount; level++)
+	{
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, GetLevelDimension(width, level), GetLevelDimension(height, level),
+			1, internalFormat, levelSize[level], &data[levelOffset[level]]);
+	}
+}
+
+bool KtxFile::LoadCooked(const string& sourceFile)
+{
+	string ktxPath = GetKtxPath(sourceFile);
+
+	//A missing source is fine, the cooked copy may be all that ships.
+	int64_t ktxTime, sourceTime;
+	if (!GetModifiedTime(ktxPath, ktxTime))
+	{
+		return false;
+	}
+	if (GetModifiedTime(sourceFile, sourceTime) && sourceTime > ktxTime)
+	{
+		printf("Cooked texture %s is older than %s, loading the source\n", ktxPath.c_str(), sourceFile.c_str());
+		return false;
+	}
+
+	return Load(ktxPath);
+}
+
+string KtxFile::GetKtxPath(const string& sourceFile)
+{
+	size_t dot = sourceFile.rfind('.');
+	size_t slash = sourceFile.find_last_of("/\\");
+
+	if (dot == string::npos || (slash != string::npos && dot < slash))
+	{
+		return sourceFile + ".ktx";
+	}
+
+	return sourceFile.substr(0, dot) + ".ktx";
+}
+
+bool KtxFile::IsSupported()
+{
+	return GLEW_EXT_texture_compression_s3tc != 0;
+}
+
+bool KtxFile::GetModifiedTime(const string& fileName, int64_t& time)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(fileName.c_str(), &info) != 0)
+#else
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0)
+#endif
+	{
+		return false;
+	}
+
+	time = (int64_t)info.st_mtime;
+	return true;
+}
+
+GLsizei KtxFile::GetLevelDimension(GLsizei size, GLuint level)
+{
+	size >>= level;
+	return size > 0 ? size : 1;
+}
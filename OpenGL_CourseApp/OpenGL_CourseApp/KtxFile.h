@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+
+#include <GL\glew.h>
+
+using namespace std;
+
+//Reader for the block-compressed KTX files written by TextureCooker.
+//Mip levels are stored in the file, so nothing is generated at load time.
+class KtxFile
+{
+public:
+	KtxFile();
+
+	bool Load(const string& fileName);
+	//Loads the cooked copy of a source image, unless the source was edited after it was cooked.
+	bool LoadCooked(const string& sourceFile);
+
+	//Same format, size and mip count, so the files can share one texture object.
+	bool IsCompatible(const KtxFile& other) const;
+
+	GLenum GetInternalFormat() const { return internalFormat; }
+	GLsizei GetWidth() const { return width; }
+	GLsizei GetHeight() const { return height; }
+	GLuint GetLevelCount() const { return levelCount; }
+	GLuint GetFaceCount() const { return faceCount; }
+
+	//Uploads every level of one face to target (GL_TEXTURE_2D or a cube map face).
+	void UploadImage(GLenum target, GLuint face = 0) const;
+	//Allocates every level of the bound GL_TEXTURE_2D_ARRAY with this file's format.
+	void AllocateArray(GLsizei layers) const;
+	//Fills one layer of the bound GL_TEXTURE_2D_ARRAY.
+	void UploadLayer(GLint layer) const;
+
+	static string GetKtxPath(const string& sourceFile);
+	static bool IsSupported();
+
+private:
+	static GLsizei GetLevelDimension(GLsizei size, GLuint level);
+	static bool GetModifiedTime(const string& fileName, int64_t& time);
+
+	vector<unsigned char> data;
+	vector<size_t> levelOffset;		//First face of each level.
+	vector<GLsizei> levelSize;		//Bytes per face.
+
+	GLenum internalFormat;
+	GLsizei width, height;
+	GLuint levelCount, faceCount;
+};
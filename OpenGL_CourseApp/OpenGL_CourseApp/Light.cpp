@@ -28,6 +28,13 @@ Light::Light(GLfloat shadowWidth, GLfloat shadowHeight, GLfloat red, GLfloat gre
 //	glUniform1f(diffuseIntensityLocation,diffuseIntensity);
 //}
 
+void Light::WriteBlock(LightBlock& block)
+{
+	block.colour = colour;
+	block.ambientIntensity = ambientIntensity;
+	block.diffuseIntensity = diffuseIntensity;
+}
+
 Light::~Light()
 {
 }
@@ -5,6 +5,7 @@
 #include <glm\gtc\matrix_transform.hpp>
 
 #include "ShadowMap.h"
+#include "UniformBlocks.h"
 
 class Light
 {
@@ -21,6 +22,9 @@ public:
 
 	//void UseLight(GLfloat ambientIntensityLocation,GLfloat ambientColourLocation, GLfloat diffuseIntensityLocation);
 
+	//Fills the light's part of the std140 Lights block.
+	void WriteBlock(LightBlock& block);
+
 	~Light();
 
 protected:
@@ -14,8 +14,8 @@ Material::Material(GLfloat intensity, GLfloat shine)
 
 void Material::UseMaterial(GLuint specularIntensityLocation, GLuint shininessLocation)
 {
-	glUniform1f(specularIntensityLocation,specularIntensity);
-	glUniform1f(shininessLocation, shininess);
+	GLState::Uniform1f(specularIntensityLocation, specularIntensity);
+	GLState::Uniform1f(shininessLocation, shininess);
 
 }
 
@@ -2,74 +2,101 @@
 
 Mesh::Mesh()
 {
-	VAO = 0;
-	VBO = 0;
-	IBO = 0;
-	indexCount = 0;
+	allocation = GeometryArena::Allocation();
+	allocated = false;
+	lodCount = 1;
+	lodFirstIndex[0] = 0;
+	lodIndexCount[0] = 0;
 }
 
 void Mesh::CreateMesh(GLfloat * vertices, unsigned int * indices, unsigned int numOfVertices, unsigned int numOfIndices)
 {
-	indexCount = numOfIndices;
+	vector<VertexPacking::PackedMesh> packed;
+	VertexPacking::PackMesh(vertices, numOfVertices, indices, numOfIndices, packed);
 
-	//Vertex Specification:
-	//Creating VAO/VBO
-	glGenVertexArrays(1, &VAO); //Generate VAO ID
-	glBindVertexArray(VAO);	   //Bind the VAO with ID.
-
-	glGenBuffers(1, &IBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * numOfIndices, indices, GL_STATIC_DRAW);
+	//One Mesh draws one arena range, Model splits its meshes before they get here.
+	if (packed.size() != 1)
+	{
+		printf("Mesh of %u vertices does not fit 16-bit indices\n", numOfVertices / 8);
+		return;
+	}
 
-	glGenBuffers(1, &VBO);	//Generate VBO ID.
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);	//Bind the VBO with ID.
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices[0]) * numOfVertices, vertices, GL_STATIC_DRAW);  //Attach the vertex data to that VBO.
+	CreateMesh(packed[0].vertices.data(), packed[0].indices.data(), (unsigned int)packed[0].vertices.size(),
+		(unsigned int)packed[0].indices.size());
+}
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, 0); //Define the Attribute Pointer Formatting.
-	glEnableVertexAttribArray(0);	//Enable the Attribute Pointer.
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, (void*)(sizeof(vertices[0]) * 3));
-	glEnableVertexAttribArray(1);
+void Mesh::CreateMesh(const PackedVertex * vertices, const PackedIndex * indices, unsigned int vertexCount, unsigned int indexCount,
+	unsigned int lodCount, const unsigned int * lodIndexCounts)
+{
+	//Vertex Specification:
+	//The vertices and indices go into the shared arena buffers, whose VAO already has the format.
+	allocated = GeometryArena::Allocate(vertices, indices, vertexCount, indexCount, allocation);
+	if (!allocated)
+	{
+		return;
+	}
 
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]) * 8, (void*)(sizeof(vertices[0]) * 5));
-	glEnableVertexAttribArray(2);
-		
-	glBindBuffer(GL_ARRAY_BUFFER, 0); //Unbind VBO
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	this->lodCount = !lodIndexCounts || lodCount < 1 ? 1 : (lodCount > MAX_LODS ? MAX_LODS : lodCount);
 
-	glBindVertexArray(0);	//Unbind VAO
+	GLuint first = 0;
+	for (unsigned int i = 0; i < this->lodCount; i++)
+	{
+		lodFirstIndex[i] = first;
+		lodIndexCount[i] = lodIndexCounts ? lodIndexCounts[i] : indexCount;
+		first += lodIndexCount[i];
+	}
 }
 
-void Mesh::RenderMesh()
+void Mesh::RenderMesh(GLsizei views, unsigned int lod)
 {
-	glBindVertexArray(VAO);  //Bind the VAO.
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
-	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+	GLsizei indexCount = GetIndexCount(lod);
+	if (indexCount == 0)
+	{
+		return;
+	}
+
+	GeometryArena::Bind();  //The same VAO for every mesh, GLState skips it after the first draw.
+	const void* firstIndex = (const void*)(sizeof(PackedIndex) * GetFirstIndex(lod));
+	if (views > 1)
+	{
+		//Keeps any attached instance data on its first element for every view.
+		GeometryArena::SetInstanceDivisor(views);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, GeometryArena::INDEX_TYPE, firstIndex, views, allocation.baseVertex);
+	}
+	else
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GeometryArena::INDEX_TYPE, firstIndex, allocation.baseVertex);
+	}
 	//glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);//Unbind VAO.
 }
 
-void Mesh::ClearMesh()
+void Mesh::RenderMeshInstanced(GLuint instanceBuffer, GLsizei instanceCount, GLuint layerBuffer, GLsizei views, unsigned int lod)
 {
-	if (IBO != 0)
+	GLsizei indexCount = GetIndexCount(lod);
+	if (indexCount == 0)
 	{
-		glDeleteBuffers(1, &IBO);
-		IBO = 0;
+		return;
 	}
 
-	if (VBO != 0)
-	{
-		glDeleteBuffers(1, &VBO);
-		VBO = 0;
-	}
+	GeometryArena::AttachInstanceBuffers(instanceBuffer, layerBuffer);
+	GeometryArena::SetInstanceDivisor(views);
+
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, GeometryArena::INDEX_TYPE, (const void*)(sizeof(PackedIndex) * GetFirstIndex(lod)),
+		instanceCount * views, allocation.baseVertex);
+}
 
-	if (VAO != 0)
+void Mesh::ClearMesh()
+{
+	if (allocated)
 	{
-		glDeleteVertexArrays(1, &VAO);
-		VAO = 0;
+		GeometryArena::Free(allocation);
+		allocated = false;
 	}
 
-	indexCount = 0;
+	allocation = GeometryArena::Allocation();
+	lodCount = 1;
+	lodFirstIndex[0] = 0;
+	lodIndexCount[0] = 0;
 }
 
 Mesh::~Mesh()
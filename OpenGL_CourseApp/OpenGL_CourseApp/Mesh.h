@@ -1,21 +1,45 @@
 #pragma once
 #include <GL/glew.h>
 
+#include "GLState.h"
+#include "GeometryArena.h"
+
 class Mesh
 {
 public:
 	Mesh();
 
+	//The 8-float layout, packed on the way in. numOfVertices counts floats.
 	void CreateMesh(GLfloat *vertices,unsigned int *indices, unsigned int numOfVertices,unsigned int numOfIndices);
-	void RenderMesh();
+	//indices holds lodCount levels of detail back to back, LOD 0 first, all indexing the same vertices.
+	//lodIndexCounts may be left out for a single level.
+	void CreateMesh(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount,
+		unsigned int lodCount = 1, const unsigned int* lodIndexCounts = nullptr);
+	//views > 1 draws every instance that many times in a row (gl_InstanceID % views picks the view).
+	//A lod past the mesh's last level draws the last one.
+	void RenderMesh(GLsizei views = 1, unsigned int lod = 0);
+	void RenderMeshInstanced(GLuint instanceBuffer, GLsizei instanceCount, GLuint layerBuffer = 0, GLsizei views = 1, unsigned int lod = 0);
 	void ClearMesh();
 
+	static const unsigned int MAX_LODS = 4;
+
+	unsigned int GetLodCount() { return lodCount; }
+	GLsizei GetIndexCount(unsigned int lod = 0) { return lodIndexCount[ClampLod(lod)]; }
+
+	//Where the mesh lives in the GeometryArena, for indirect draws.
+	GLuint GetFirstIndex(unsigned int lod = 0) { return allocation.firstIndex + lodFirstIndex[ClampLod(lod)]; }
+	GLint GetBaseVertex() { return allocation.baseVertex; }
+
 	~Mesh();
 
 private:
-	GLuint VAO, VBO, IBO;
-	GLsizei	indexCount;
+	unsigned int ClampLod(unsigned int lod) { return lod < lodCount ? lod : lodCount - 1; }
 
+	GeometryArena::Allocation allocation;
+	bool allocated;
+	unsigned int lodCount;
+	GLuint lodFirstIndex[MAX_LODS];	//From the start of the allocation.
+	GLsizei	lodIndexCount[MAX_LODS];
 
-};
 
+};
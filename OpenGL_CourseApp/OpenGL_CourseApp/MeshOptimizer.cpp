@@ -0,0 +1,359 @@
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <algorithm>
+
+//A vertex is in the FIFO cache if fewer than cacheSize misses happened since it went in.
+//Moving time on by more than the cache size empties it.
+static unsigned int CountTriangleMisses(const PackedIndex* triangle, vector<unsigned int>& cacheTime, unsigned int& time, unsigned int cacheSize)
+{
+	unsigned int misses = 0;
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		if (time - cacheTime[triangle[k]] > cacheSize)
+		{
+			cacheTime[triangle[k]] = time++;
+			misses++;
+		}
+	}
+
+	return misses;
+}
+
+void MeshOptimizer::OptimizeMesh(vector<PackedVertex>& vertices, vector<PackedIndex>& indices)
+{
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeOverdraw(indices, vertices);
+	OptimizeVertexFetch(vertices, indices);
+}
+
+void MeshOptimizer::OptimizeVertexCache(vector<PackedIndex>& indices, unsigned int vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//Triangles using each vertex, all lists in one array. A list's first remaining[v] entries are the
+	//triangles still to draw.
+	vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+
+	vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+	}
+
+	vector<unsigned int> adjacency(triangleCount * 3);
+	vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<GLfloat> vertexScore(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	vector<GLfloat> triangleScore(triangleCount);
+	vector<unsigned char> emitted(triangleCount, 0);
+	int best = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[best])
+		{
+			best = t;
+		}
+	}
+
+	vector<PackedIndex> ordered;
+	ordered.reserve(triangleCount * 3);
+
+	//Most recently used first. The triangle just drawn can push up to three vertices past the end.
+	vector<unsigned int> cache, newCache;
+	size_t scanCursor = 0;
+
+	while (ordered.size() < triangleCount * 3)
+	{
+		if (best < 0)
+		{
+			//Nothing in the cache has triangles left, carry on with the next one not drawn yet.
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			best = scanCursor;
+		}
+
+		const PackedIndex* triangle = &indices[best * 3];
+		emitted[best] = 1;
+		ordered.insert(ordered.end(), triangle, triangle + 3);
+
+		newCache.clear();
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+
+			unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (list[j] == (unsigned int)best)
+				{
+					list[j] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+
+			if (find(newCache.begin(), newCache.end(), v) == newCache.end())
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		size_t triangleVertices = newCache.size();
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			if (find(newCache.begin(), newCache.begin() + triangleVertices, cache[i]) == newCache.begin() + triangleVertices)
+			{
+				newCache.push_back(cache[i]);
+			}
+		}
+
+		//Rescore everything that moved in the cache, or fell out of it, and their triangles with them.
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < LRU_CACHE_SIZE ? (int)i : -1;
+
+			GLfloat score = VertexScore(cachePosition[v], remaining[v]);
+			GLfloat delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				triangleScore[list[j]] += delta;
+			}
+		}
+
+		if (newCache.size() > LRU_CACHE_SIZE)
+		{
+			newCache.resize(LRU_CACHE_SIZE);
+		}
+		cache.swap(newCache);
+
+		//The next triangle is the best one touching the cache.
+		best = -1;
+		GLfloat bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (triangleScore[list[j]] > bestScore)
+				{
+					bestScore = triangleScore[list[j]];
+					best = list[j];
+				}
+			}
+		}
+	}
+
+	indices.swap(ordered);
+}
+
+void MeshOptimizer::OptimizeOverdraw(vector<PackedIndex>& indices, const vector<PackedVertex>& vertices, GLfloat threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	vector<unsigned int> cacheTime(vertices.size(), 0);
+	unsigned int time = FIFO_CACHE_SIZE + 1;
+
+	//Hard boundaries: triangles that miss on all three vertices start with a cold cache anyway.
+	vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (CountTriangleMisses(&indices[t * 3], cacheTime, time, FIFO_CACHE_SIZE) == 3 || t == 0)
+		{
+			hardBoundaries.push_back(t);
+		}
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	//Soft boundaries: within a hard run, cut once the cluster so far reuses the cache about as
+	//well as the whole run does. Each cluster is counted from a cold cache, as it may move anywhere.
+	vector<size_t> clusters;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+	{
+		size_t start = hardBoundaries[h], end = hardBoundaries[h + 1];
+
+		time += FIFO_CACHE_SIZE + 1;
+		unsigned int runMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			runMisses += CountTriangleMisses(&indices[t * 3], cacheTime, time, FIFO_CACHE_SIZE);
+		}
+		GLfloat target = threshold * runMisses / (GLfloat)(end - start);
+
+		time += FIFO_CACHE_SIZE + 1;
+		clusters.push_back(start);
+		size_t clusterStart = start;
+		unsigned int clusterMisses = 0;
+		for (size_t t = start; t < end; t++)
+		{
+			clusterMisses += CountTriangleMisses(&indices[t * 3], cacheTime, time, FIFO_CACHE_SIZE);
+
+			if (t + 1 < end && clusterMisses <= target * (t + 1 - clusterStart))
+			{
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				clusters.push_back(clusterStart);
+				time += FIFO_CACHE_SIZE + 1;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	//Area weighted centroid and normal of every cluster, and the centroid of the mesh.
+	vector<glm::vec3> positions(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		positions[v] = VertexPacking::GetPosition(vertices[v]);
+	}
+
+	size_t clusterCount = clusters.size() - 1;
+	vector<glm::vec3> clusterCentroid(clusterCount), clusterNormal(clusterCount);
+	glm::vec3 meshCentroid(0.0f, 0.0f, 0.0f);
+	GLfloat meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		glm::vec3 centroid(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f);
+		GLfloat area = 0.0f;
+
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+		{
+			const glm::vec3& a = positions[indices[t * 3]];
+			const glm::vec3& b = positions[indices[t * 3 + 1]];
+			const glm::vec3& p = positions[indices[t * 3 + 2]];
+
+			glm::vec3 cross = glm::cross(b - a, p - a);
+			GLfloat triangleArea = glm::length(cross);
+
+			centroid += (a + b + p) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		clusterCentroid[c] = area > 0.0f ? centroid / area : centroid;
+		GLfloat normalLength = glm::length(normal);
+		clusterNormal[c] = normalLength > 0.0f ? normal / normalLength : normal;
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	vector<GLfloat> sortKey(clusterCount);
+	vector<size_t> clusterOrder(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		sortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c]);
+		clusterOrder[c] = c;
+	}
+
+	stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+	vector<PackedIndex> ordered;
+	ordered.reserve(triangleCount * 3);
+	for (size_t i = 0; i < clusterCount; i++)
+	{
+		size_t c = clusterOrder[i];
+		ordered.insert(ordered.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+
+	indices.swap(ordered);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(vector<PackedVertex>& vertices, vector<PackedIndex>& indices)
+{
+	vector<int> remap(vertices.size(), -1);
+	vector<PackedVertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		PackedIndex v = indices[i];
+		if (remap[v] < 0)
+		{
+			remap[v] = ordered.size();
+			ordered.push_back(vertices[v]);
+		}
+
+		indices[i] = (PackedIndex)remap[v];
+	}
+
+	vertices.swap(ordered);
+}
+
+unsigned int MeshOptimizer::CountCacheMisses(const vector<PackedIndex>& indices, unsigned int vertexCount)
+{
+	vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = FIFO_CACHE_SIZE + 1;
+	unsigned int misses = 0;
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		misses += CountTriangleMisses(&indices[t], cacheTime, time, FIFO_CACHE_SIZE);
+	}
+
+	return misses;
+}
+
+GLfloat MeshOptimizer::VertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	//Nothing left to draw with it.
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+
+	//The last triangle's vertices get a fixed score so the next one does not just reuse a single edge,
+	//the rest fall off with their age in the cache.
+	GLfloat score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			score = 0.75f;
+		}
+		else
+		{
+			score = powf(1.0f - (cachePosition - 3) / (GLfloat)(LRU_CACHE_SIZE - 3), 1.5f);
+		}
+	}
+
+	//Vertices with few triangles left are worth finishing off.
+	score += 2.0f * powf((GLfloat)remainingTriangles, -0.5f);
+
+	return score;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+#include "VertexLayout.h"
+
+using namespace std;
+
+//Reorders packed meshes once at import, before they are cached, so the GPU reuses
+//more of its post-transform cache, draws less hidden surface and fetches vertices in order.
+//Triangles keep their winding, only their order and the vertex numbering change.
+class MeshOptimizer
+{
+public:
+	//Vertex cache, then overdraw, then vertex fetch.
+	static void OptimizeMesh(vector<PackedVertex>& vertices, vector<PackedIndex>& indices);
+
+	//Forsyth's linear-speed greedy ordering, scoring vertices by their place in a simulated LRU cache
+	//and how many triangles they still have left to draw.
+	static void OptimizeVertexCache(vector<PackedIndex>& indices, unsigned int vertexCount);
+
+	//Cuts the cache-ordered triangles into clusters wherever that costs few extra cache misses,
+	//then draws the clusters facing away from the mesh centre first, as they tend to occlude the rest.
+	//threshold is how much worse than its whole run a cluster's ACMR may get.
+	static void OptimizeOverdraw(vector<PackedIndex>& indices, const vector<PackedVertex>& vertices, GLfloat threshold = 1.05f);
+
+	//Renumbers vertices in the order the indices first use them, dropping unused ones.
+	static void OptimizeVertexFetch(vector<PackedVertex>& vertices, vector<PackedIndex>& indices);
+
+	//Misses of a FIFO cache of FIFO_CACHE_SIZE drawing the indices in order. Over the triangle count
+	//this is the ACMR: 3 for no reuse at all, around 0.6 for a well ordered closed mesh.
+	static unsigned int CountCacheMisses(const vector<PackedIndex>& indices, unsigned int vertexCount);
+
+private:
+	static const unsigned int FIFO_CACHE_SIZE = 16;
+	static const unsigned int LRU_CACHE_SIZE = 32;
+
+	static GLfloat VertexScore(int cachePosition, unsigned int remainingTriangles);
+};
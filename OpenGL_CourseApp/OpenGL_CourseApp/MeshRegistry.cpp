@@ -0,0 +1,110 @@
+#include "MeshRegistry.h"
+
+static const uint64_t CHECK_HASH_SEED = 0x9E3779B97F4A7C15ULL;
+
+unordered_map<uint64_t, MeshRegistry::MeshEntry> MeshRegistry::meshes;
+
+unsigned int MeshRegistry::hitCount = 0;
+unsigned int MeshRegistry::missCount = 0;
+size_t MeshRegistry::bytesSaved = 0;
+double MeshRegistry::secondsSaved = 0.0;
+
+Mesh* MeshRegistry::AcquireMesh(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount,
+	unsigned int lodCount, const unsigned int* lodIndexCounts)
+{
+	uint64_t key = HashGeometry(vertices, indices, vertexCount, indexCount);
+	uint64_t checkHash = CheckHashGeometry(vertices, indices, vertexCount, indexCount);
+
+	auto found = meshes.find(key);
+	if (found != meshes.end() && SameGeometry(found->second, checkHash, vertexCount, indexCount, lodCount, lodIndexCounts))
+	{
+		found->second.refCount++;
+
+		hitCount++;
+		bytesSaved += sizeof(vertices[0]) * vertexCount + sizeof(indices[0]) * indexCount;
+		secondsSaved += found->second.createSeconds;
+
+		return found->second.mesh;
+	}
+
+	auto start = chrono::high_resolution_clock::now();
+
+	Mesh* mesh = new Mesh();
+	mesh->CreateMesh(vertices, indices, vertexCount, indexCount, lodCount, lodIndexCounts);
+
+	chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+
+	missCount++;
+
+	//A key collision with different geometry just leaves the new mesh unshared.
+	if (found == meshes.end())
+	{
+		MeshEntry& entry = meshes[key];
+		entry.mesh = mesh;
+		entry.refCount = 1;
+		entry.createSeconds = elapsed.count();
+		entry.vertexCount = vertexCount;
+		entry.indexCount = indexCount;
+		entry.checkHash = checkHash;
+		if (lodIndexCounts)
+		{
+			entry.lodIndexCounts.assign(lodIndexCounts, lodIndexCounts + lodCount);
+		}
+	}
+
+	return mesh;
+}
+
+void MeshRegistry::ReleaseMesh(Mesh* mesh)
+{
+	for (auto it = meshes.begin(); it != meshes.end(); ++it)
+	{
+		if (it->second.mesh == mesh)
+		{
+			if (--it->second.refCount == 0)
+			{
+				delete mesh;
+				meshes.erase(it);
+			}
+			return;
+		}
+	}
+
+	delete mesh;
+}
+
+bool MeshRegistry::SameGeometry(const MeshEntry& entry, uint64_t checkHash, unsigned int vertexCount, unsigned int indexCount,
+	unsigned int lodCount, const unsigned int* lodIndexCounts)
+{
+	if (entry.checkHash != checkHash || entry.vertexCount != vertexCount || entry.indexCount != indexCount ||
+		entry.lodIndexCounts.size() != (lodIndexCounts ? lodCount : 0))
+	{
+		return false;
+	}
+
+	for (size_t l = 0; l < entry.lodIndexCounts.size(); l++)
+	{
+		if (entry.lodIndexCounts[l] != lodIndexCounts[l])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint64_t MeshRegistry::HashGeometry(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount)
+{
+	uint64_t hash = HashBytes(vertices, sizeof(vertices[0]) * vertexCount);
+	hash = HashBytes(indices, sizeof(indices[0]) * indexCount, hash);
+
+	return hash;
+}
+
+uint64_t MeshRegistry::CheckHashGeometry(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount)
+{
+	uint64_t hash = HashBytes(indices, sizeof(indices[0]) * indexCount, CHECK_HASH_SEED);
+	hash = HashBytes(vertices, sizeof(vertices[0]) * vertexCount, hash);
+
+	return hash;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "Mesh.h"
+#include "Hash.h"
+
+using namespace std;
+
+//Process-wide table of uploaded meshes keyed by a hash of their vertex and index data,
+//so models with identical geometry share one set of GPU buffers.
+class MeshRegistry
+{
+public:
+	static Mesh* AcquireMesh(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount,
+		unsigned int lodCount = 1, const unsigned int* lodIndexCounts = nullptr);
+	static void ReleaseMesh(Mesh* mesh);
+
+	static unsigned int GetHitCount() { return hitCount; }
+	static unsigned int GetMissCount() { return missCount; }
+	static size_t GetBytesSaved() { return bytesSaved; }
+	static double GetSecondsSaved() { return secondsSaved; }
+
+private:
+	struct MeshEntry
+	{
+		Mesh* mesh;
+		unsigned int refCount;
+		double createSeconds;
+
+		//Checked on every hit instead of keeping a copy of the geometry: the sizes, the LOD ranges
+		//and a second hash of the data fed in the other order, from another seed.
+		unsigned int vertexCount, indexCount;
+		vector<unsigned int> lodIndexCounts;
+		uint64_t checkHash;
+	};
+
+	static bool SameGeometry(const MeshEntry& entry, uint64_t checkHash, unsigned int vertexCount, unsigned int indexCount,
+		unsigned int lodCount, const unsigned int* lodIndexCounts);
+
+	static uint64_t HashGeometry(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount);
+	static uint64_t CheckHashGeometry(const PackedVertex* vertices, const PackedIndex* indices, unsigned int vertexCount, unsigned int indexCount);
+
+	static unordered_map<uint64_t, MeshEntry> meshes;
+
+	static unsigned int hitCount, missCount;
+	static size_t bytesSaved;
+	static double secondsSaved;
+};
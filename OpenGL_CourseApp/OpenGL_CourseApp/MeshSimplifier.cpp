@@ -0,0 +1,317 @@
+#include "MeshSimplifier.h"
+
+#include <math.h>
+#include <algorithm>
+#include <unordered_map>
+
+GLfloat MeshSimplifier::Simplify(const vector<PackedVertex>& vertices, const vector<PackedIndex>& indices, size_t targetIndexCount,
+	GLfloat maxError, vector<PackedIndex>& simplified)
+{
+	simplified = indices;
+
+	size_t vertexCount = vertices.size();
+	if (indices.size() <= targetIndexCount || vertexCount == 0)
+	{
+		return 0.0f;
+	}
+
+	//Centred and scaled into a unit sphere, so errors come out relative to the mesh's size.
+	vector<glm::vec3> positions(vertexCount);
+	glm::vec3 minimum = VertexPacking::GetPosition(vertices[0]), maximum = minimum;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		positions[v] = VertexPacking::GetPosition(vertices[v]);
+		minimum = glm::min(minimum, positions[v]);
+		maximum = glm::max(maximum, positions[v]);
+	}
+
+	glm::vec3 center = (minimum + maximum) * 0.5f;
+	GLfloat radius = 0.0f;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		radius = glm::max(radius, glm::length(positions[v] - center));
+	}
+
+	if (radius <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		positions[v] = (positions[v] - center) / radius;
+	}
+
+	vector<unsigned char> locked;
+	LockVertices(vertices, indices, locked);
+
+	Quadric empty = {};
+	vector<Quadric> quadrics(vertexCount, empty);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		Quadric plane = MakePlaneQuadric(positions[indices[t]], positions[indices[t + 1]], positions[indices[t + 2]]);
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			AddQuadric(quadrics[indices[t + k]], plane);
+		}
+	}
+
+	double maxCost = (double)maxError * maxError;
+	GLfloat reached = 0.0f;
+
+	vector<unsigned int> adjacencyStart(vertexCount + 1), adjacency, fill;
+	vector<unsigned int> remap(vertexCount);
+	vector<unsigned char> touched(vertexCount);
+	vector<Collapse> collapses;
+
+	//Each pass collapses a set of edges far enough apart not to affect each other's checks.
+	while (simplified.size() > targetIndexCount)
+	{
+		//Triangles around each vertex, for the flip test.
+		fill.assign(vertexCount, 0);
+		for (size_t i = 0; i < simplified.size(); i++)
+		{
+			fill[simplified[i]]++;
+		}
+		adjacencyStart[0] = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacencyStart[v + 1] = adjacencyStart[v] + fill[v];
+			fill[v] = adjacencyStart[v];
+		}
+		adjacency.resize(simplified.size());
+		for (size_t i = 0; i < simplified.size(); i++)
+		{
+			adjacency[fill[simplified[i]]++] = i / 3;
+		}
+
+		//Every edge usable at all lies between two triangles, so looking at it from one side is enough.
+		collapses.clear();
+		for (size_t t = 0; t + 2 < simplified.size(); t += 3)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				unsigned int a = simplified[t + k], b = simplified[t + (k + 1) % 3];
+				if (a >= b || (locked[a] && locked[b]))
+				{
+					continue;
+				}
+
+				double errorAB = locked[a] ? HUGE_VAL : CollapseError(quadrics[a], quadrics[b], positions[b]);
+				double errorBA = locked[b] ? HUGE_VAL : CollapseError(quadrics[b], quadrics[a], positions[a]);
+
+				Collapse collapse;
+				collapse.from = errorAB <= errorBA ? a : b;
+				collapse.to = errorAB <= errorBA ? b : a;
+				collapse.error = glm::min(errorAB, errorBA);
+				collapses.push_back(collapse);
+			}
+		}
+
+		sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+		//A collapse takes about two triangles with it.
+		size_t collapseGoal = (simplified.size() - targetIndexCount) / 6 + 1;
+		size_t performed = 0;
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			remap[v] = v;
+		}
+		touched.assign(vertexCount, 0);
+
+		for (size_t i = 0; i < collapses.size() && performed < collapseGoal; i++)
+		{
+			const Collapse& collapse = collapses[i];
+			if (collapse.error > maxCost)
+			{
+				break;
+			}
+
+			if (touched[collapse.from] || touched[collapse.to] ||
+				FlipsTriangles(collapse.from, collapse.to, simplified, positions, adjacencyStart, adjacency))
+			{
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			reached = glm::max(reached, (GLfloat)sqrt(collapse.error));
+			performed++;
+
+			//Everything around the moved vertex waits for the next pass.
+			for (unsigned int j = adjacencyStart[collapse.from]; j < adjacencyStart[collapse.from + 1]; j++)
+			{
+				const PackedIndex* triangle = &simplified[adjacency[j] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+			}
+		}
+
+		if (performed == 0)
+		{
+			break;
+		}
+
+		//Rewrite the triangles, dropping the ones that collapsed into an edge.
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < simplified.size(); t += 3)
+		{
+			PackedIndex a = remap[simplified[t]], b = remap[simplified[t + 1]], c = remap[simplified[t + 2]];
+			if (a != b && b != c && a != c)
+			{
+				simplified[write++] = a;
+				simplified[write++] = b;
+				simplified[write++] = c;
+			}
+		}
+		simplified.resize(write);
+	}
+
+	return reached;
+}
+
+void MeshSimplifier::LockVertices(const vector<PackedVertex>& vertices, const vector<PackedIndex>& indices, vector<unsigned char>& locked)
+{
+	//Vertices sharing a position are one corner of the surface split by a seam.
+	vector<unsigned int> positionID(vertices.size());
+	vector<unsigned int> positionUses;
+	unordered_map<uint64_t, unsigned int> positionIDs;
+
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		const uint16_t* position = vertices[v].position;
+		uint64_t key = (uint64_t)position[0] | ((uint64_t)position[1] << 16) | ((uint64_t)position[2] << 32);
+
+		auto found = positionIDs.find(key);
+		if (found == positionIDs.end())
+		{
+			found = positionIDs.insert(make_pair(key, (unsigned int)positionUses.size())).first;
+			positionUses.push_back(0);
+		}
+
+		positionID[v] = found->second;
+		positionUses[found->second]++;
+	}
+
+	vector<unsigned char> lockedPosition(positionUses.size(), 0);
+	for (size_t p = 0; p < positionUses.size(); p++)
+	{
+		lockedPosition[p] = positionUses[p] > 1 ? 1 : 0;
+	}
+
+	//Edges of the surface, counted across seams: one triangle is an open border, more than two is non-manifold.
+	unordered_map<uint64_t, unsigned int> edgeUses;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int a = positionID[indices[t + k]], b = positionID[indices[t + (k + 1) % 3]];
+			uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+			edgeUses[key]++;
+		}
+	}
+
+	for (auto it = edgeUses.begin(); it != edgeUses.end(); ++it)
+	{
+		if (it->second != 2)
+		{
+			lockedPosition[it->first >> 32] = 1;
+			lockedPosition[it->first & 0xFFFFFFFF] = 1;
+		}
+	}
+
+	locked.resize(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		locked[v] = lockedPosition[positionID[v]];
+	}
+}
+
+MeshSimplifier::Quadric MeshSimplifier::MakePlaneQuadric(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	glm::vec3 normal = glm::cross(b - a, c - a);
+	double area = glm::length(normal);
+
+	Quadric quadric = {};
+	if (area <= 0.0)
+	{
+		return quadric;
+	}
+
+	double nx = normal.x / area, ny = normal.y / area, nz = normal.z / area;
+	double d = -(nx * a.x + ny * a.y + nz * a.z);
+
+	quadric.a2 = area * nx * nx;
+	quadric.b2 = area * ny * ny;
+	quadric.c2 = area * nz * nz;
+	quadric.ab = area * nx * ny;
+	quadric.ac = area * nx * nz;
+	quadric.bc = area * ny * nz;
+	quadric.ad = area * nx * d;
+	quadric.bd = area * ny * d;
+	quadric.cd = area * nz * d;
+	quadric.d2 = area * d * d;
+	quadric.weight = area;
+
+	return quadric;
+}
+
+void MeshSimplifier::AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.a2 += other.a2;
+	quadric.b2 += other.b2;
+	quadric.c2 += other.c2;
+	quadric.ab += other.ab;
+	quadric.ac += other.ac;
+	quadric.bc += other.bc;
+	quadric.ad += other.ad;
+	quadric.bd += other.bd;
+	quadric.cd += other.cd;
+	quadric.d2 += other.d2;
+	quadric.weight += other.weight;
+}
+
+double MeshSimplifier::CollapseError(const Quadric& from, const Quadric& to, const glm::vec3& position)
+{
+	Quadric sum = from;
+	AddQuadric(sum, to);
+
+	double x = position.x, y = position.y, z = position.z;
+	double error = sum.a2 * x * x + sum.b2 * y * y + sum.c2 * z * z
+		+ 2.0 * (sum.ab * x * y + sum.ac * x * z + sum.bc * y * z)
+		+ 2.0 * (sum.ad * x + sum.bd * y + sum.cd * z) + sum.d2;
+
+	//Mean squared distance to the planes, rounding can take it just under zero.
+	return sum.weight > 0.0 ? glm::max(error / sum.weight, 0.0) : 0.0;
+}
+
+bool MeshSimplifier::FlipsTriangles(unsigned int from, unsigned int to, const vector<PackedIndex>& indices, const vector<glm::vec3>& positions,
+	const vector<unsigned int>& adjacencyStart, const vector<unsigned int>& adjacency)
+{
+	for (unsigned int j = adjacencyStart[from]; j < adjacencyStart[from + 1]; j++)
+	{
+		const PackedIndex* triangle = &indices[adjacency[j] * 3];
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+		{
+			continue; //Collapses with the edge.
+		}
+
+		glm::vec3 before[3], after[3];
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			before[k] = positions[triangle[k]];
+			after[k] = triangle[k] == from ? positions[to] : before[k];
+		}
+
+		glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+		glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+		//Also refuses to tilt a triangle by more than about 75 degrees.
+		if (glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
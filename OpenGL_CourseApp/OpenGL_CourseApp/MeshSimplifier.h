@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+#include "VertexLayout.h"
+
+using namespace std;
+
+//Quadric error edge collapse (Garland and Heckbert) for building a mesh's LODs at import.
+//A vertex only ever collapses onto one of its neighbours, so every level indexes the same
+//vertex array and only adds an index range. Vertices on open borders, on texture or normal
+//seams (several vertices at one position) or on non-manifold edges never move, so levels
+//keep their outline and their texture mapping.
+class MeshSimplifier
+{
+public:
+	//Collapses the cheapest edges until at most targetIndexCount indices are left, or the next collapse
+	//would move the surface by more than maxError, relative to the mesh's bounding radius.
+	//Returns the error reached, in the same units.
+	static GLfloat Simplify(const vector<PackedVertex>& vertices, const vector<PackedIndex>& indices, size_t targetIndexCount,
+		GLfloat maxError, vector<PackedIndex>& simplified);
+
+private:
+	//Sum of squared distances to a set of planes, each weighted by its triangle's area.
+	struct Quadric
+	{
+		double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+		double weight;
+	};
+
+	struct Collapse
+	{
+		unsigned int from, to;
+		double error;
+	};
+
+	static void LockVertices(const vector<PackedVertex>& vertices, const vector<PackedIndex>& indices, vector<unsigned char>& locked);
+
+	static Quadric MakePlaneQuadric(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	static void AddQuadric(Quadric& quadric, const Quadric& other);
+	static double CollapseError(const Quadric& from, const Quadric& to, const glm::vec3& position);
+
+	//Would moving from onto to turn any of from's other triangles over.
+	static bool FlipsTriangles(unsigned int from, unsigned int to, const vector<PackedIndex>& indices, const vector<glm::vec3>& positions,
+		const vector<unsigned int>& adjacencyStart, const vector<unsigned int>& adjacency);
+};
@@ -1,54 +1,160 @@
 #include "Model.h"
 
+#include <cfloat>
+
+//Each level aims for a quarter of the triangles of LOD 0 per step, as it takes over at half the
+//screen size of the one before. Simplification stops early where the surface would move by more
+//than about a pixel at the size the level takes over (maxError is relative to the mesh's radius).
+static const GLfloat lodTriangleRatio[Mesh::MAX_LODS] = { 1.0f, 0.25f, 0.0625f, 0.015625f };
+static const GLfloat lodMaxError[Mesh::MAX_LODS] = { 0.0f, 0.008f, 0.017f, 0.05f };
+static const GLfloat lodScreenSize[Mesh::MAX_LODS] = { 0.0f, 240.0f, 120.0f, 60.0f }; //Diameter in pixels below which a level is used.
+
+//How far past its threshold a level has to grow before the finer one comes back.
+static const GLfloat lodHysteresis = 1.2f;
+
+//Levels that keep most of the previous one's triangles are not worth their memory.
+static const GLfloat lodMinReduction = 0.8f;
+
 Model::Model()
 {
+	boundCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+	boundRadius = 0.0f;
+	boundMin = glm::vec3(0.0f, 0.0f, 0.0f);
+	boundMax = glm::vec3(0.0f, 0.0f, 0.0f);
+	lodCount = 1;
 }
 
-void Model::RenderModel()
+Texture* Model::GetMeshTexture(size_t mesh)
 {
-	for (size_t i = 0; i < meshList.size(); i++)
+	unsigned int materialIndex = meshToTex[mesh];
+	return materialIndex < textureList.size() ? textureList[materialIndex] : nullptr;
+}
+
+void Model::LoadModel(const std::string & fileName, bool loadMaterials)
+{
+	ModelCache cache;
+	vector<ImportedMesh> imported;
+	vector<ModelCache::CachedMesh> meshes;
+	vector<string> materialTextures;
+
+	if (cache.Open(fileName))
+	{
+		meshes = cache.GetMeshes();
+		materialTextures = cache.GetMaterialTextures();
+	}
+	else
 	{
-		unsigned int materialIndex = meshToTex[i];
+		if (!ImportModel(fileName, imported, materialTextures))
+		{
+			return;
+		}
 
-		if (materialIndex < textureList.size() && textureList[materialIndex])
+		for (size_t i = 0; i < imported.size(); i++)
 		{
-			textureList[materialIndex]->UseTexture();
+			ModelCache::CachedMesh mesh;
+			mesh.vertices = &imported[i].vertices[0];
+			mesh.indices = &imported[i].indices[0];
+			mesh.vertexCount = imported[i].vertices.size();
+			mesh.indexCount = imported[i].indices.size();
+			mesh.lodCount = imported[i].lodCount;
+			memcpy(mesh.lodIndexCount, imported[i].lodIndexCount, sizeof(mesh.lodIndexCount));
+			mesh.materialIndex = imported[i].materialIndex;
+			meshes.push_back(mesh);
 		}
 
-		meshList[i]->RenderMesh();
+		ModelCache::Write(fileName, meshes, materialTextures);
+	}
+
+	unsigned int hitsBefore = MeshRegistry::GetHitCount();
+	size_t bytesBefore = MeshRegistry::GetBytesSaved();
+	double secondsBefore = MeshRegistry::GetSecondsSaved();
+
+	CreateMeshes(meshes);
+	CalculateBounds(meshes);
+
+	if (MeshRegistry::GetHitCount() != hitsBefore)
+	{
+		printf("Model (%s) reused %u mesh(es): %zu bytes and %.3f ms of upload saved\n", fileName.c_str(),
+			MeshRegistry::GetHitCount() - hitsBefore, MeshRegistry::GetBytesSaved() - bytesBefore,
+			(MeshRegistry::GetSecondsSaved() - secondsBefore) * 1000.0);
+	}
+
+	if (loadMaterials)
+	{
+		LoadMaterials(materialTextures);
 	}
 }
 
-void Model::LoadModel(const std::string & fileName)
+bool Model::ImportModel(const string& fileName, vector<ImportedMesh>& imported, vector<string>& materialTextures)
 {
 	Assimp::Importer importer;
 	const aiScene *scene = importer.ReadFile(fileName, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices);
 
 	if (!scene)
 	{
-		printf("Model (%s) failed to load: %s", fileName, importer.GetErrorString());
-		return;
+		printf("Model (%s) failed to load: %s", fileName.c_str(), importer.GetErrorString());
+		return false;
+	}
+
+	LoadNode(scene->mRootNode, scene, imported);
+	GetMaterialTextures(scene, materialTextures);
+
+	//Reordered once here, the cache keeps the result.
+	unsigned int triangles = 0, missesBefore = 0, missesAfter = 0;
+	for (size_t i = 0; i < imported.size(); i++)
+	{
+		missesBefore += MeshOptimizer::CountCacheMisses(imported[i].indices, imported[i].vertices.size());
+		MeshOptimizer::OptimizeMesh(imported[i].vertices, imported[i].indices);
+		missesAfter += MeshOptimizer::CountCacheMisses(imported[i].indices, imported[i].vertices.size());
+		triangles += imported[i].indices.size() / 3;
 	}
 
-	LoadNode(scene->mRootNode, scene);
+	if (triangles > 0)
+	{
+		printf("Model (%s) optimized %u triangles: ACMR %.3f -> %.3f\n", fileName.c_str(), triangles,
+			missesBefore / (GLfloat)triangles, missesAfter / (GLfloat)triangles);
+	}
 
-	LoadMaterials(scene);
+	//Simplified levels only reorder for the vertex cache, they share LOD 0's vertex order.
+	unsigned int lodTriangles[Mesh::MAX_LODS] = {};
+	unsigned int levels = 0;
+	for (size_t i = 0; i < imported.size(); i++)
+	{
+		GenerateLods(imported[i]);
+		for (unsigned int l = 0; l < Mesh::MAX_LODS; l++)
+		{
+			lodTriangles[l] += imported[i].lodIndexCount[l < imported[i].lodCount ? l : imported[i].lodCount - 1] / 3;
+		}
+		levels = imported[i].lodCount > levels ? imported[i].lodCount : levels;
+	}
+
+	if (levels > 1)
+	{
+		printf("Model (%s) LOD triangles:", fileName.c_str());
+		for (unsigned int l = 0; l < levels; l++)
+		{
+			printf(" %u", lodTriangles[l]);
+		}
+		printf("\n");
+	}
+
+	return true;
 }
 
-void Model::LoadNode(aiNode * node, const aiScene * scene)
+void Model::LoadNode(aiNode * node, const aiScene * scene, vector<ImportedMesh>& imported)
 {
 	for (size_t i = 0; i < node->mNumMeshes; i++)
 	{
-		LoadMesh(scene->mMeshes[node->mMeshes[i]], scene);
+		LoadMesh(scene->mMeshes[node->mMeshes[i]], scene, imported);
 	}
 
 	for (size_t i = 0; i < node->mNumChildren; i++)
 	{
-		LoadNode(node->mChildren[i], scene);
+		LoadNode(node->mChildren[i], scene, imported);
 	}
 }
 
-void Model::LoadMesh(aiMesh * mesh, const aiScene * scene)
+void Model::LoadMesh(aiMesh * mesh, const aiScene * scene, vector<ImportedMesh>& imported)
 {
 	std::vector<GLfloat> vertices;
 	std::vector<unsigned int> indices;
@@ -75,21 +181,49 @@ void Model::LoadMesh(aiMesh * mesh, const aiScene * scene)
 		}
 	}
 
-	Mesh* newMesh = new Mesh();
-	newMesh->CreateMesh(&vertices[0], &indices[0], vertices.size(), indices.size());
-	meshList.push_back(newMesh);
-	meshToTex.push_back(mesh->mMaterialIndex);
+	vector<VertexPacking::PackedMesh> packed;
+	VertexPacking::PackMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), packed);
+
+	for (size_t i = 0; i < packed.size(); i++)
+	{
+		imported.push_back(ImportedMesh());
+		imported.back().vertices.swap(packed[i].vertices);
+		imported.back().indices.swap(packed[i].indices);
+		imported.back().materialIndex = mesh->mMaterialIndex;
+	}
 }
 
-void Model::LoadMaterials(const aiScene * scene)
+void Model::GenerateLods(ImportedMesh& mesh)
 {
-	textureList.resize(scene->mNumMaterials);
+	mesh.lodCount = 1;
+	mesh.lodIndexCount[0] = mesh.indices.size();
+
+	//Every level starts again from LOD 0, so errors do not pile up from level to level.
+	vector<PackedIndex> base(mesh.indices), simplified;
+	for (unsigned int l = 1; l < Mesh::MAX_LODS; l++)
+	{
+		size_t target = (size_t)(base.size() * lodTriangleRatio[l]) / 3 * 3;
+		MeshSimplifier::Simplify(mesh.vertices, base, target, lodMaxError[l], simplified);
+
+		if (simplified.empty() || simplified.size() > mesh.lodIndexCount[l - 1] * lodMinReduction)
+		{
+			break;
+		}
 
+		MeshOptimizer::OptimizeVertexCache(simplified, mesh.vertices.size());
+
+		mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+		mesh.lodIndexCount[l] = simplified.size();
+		mesh.lodCount++;
+	}
+}
+
+void Model::GetMaterialTextures(const aiScene * scene, vector<string>& materialTextures)
+{
 	for (size_t i = 0; i < scene->mNumMaterials; i++)
 	{
 		aiMaterial* material = scene->mMaterials[i];
-
-		textureList[i] = nullptr;
+		std::string texPath = "";
 
 		if (material->GetTextureCount(aiTextureType_DIFFUSE))
 		{
@@ -99,24 +233,140 @@ void Model::LoadMaterials(const aiScene * scene)
 				int idx = std::string(path.data).rfind("\\");
 				std::string filename = std::string(path.data).substr(idx + 1);
 
-				std::string texPath = std::string("Textures/") + filename; //Path Texture of Models.
+				texPath = std::string("Textures/") + filename; //Path Texture of Models.
+			}
+		}
 
-				textureList[i] = new Texture(texPath.c_str());
+		materialTextures.push_back(texPath);
+	}
+}
 
-				if (!textureList[i]->LoadTexture())
-				{
-					printf("Failed to load texture at: %s\n", texPath);
-					delete textureList[i];
-					textureList[i] = nullptr;
-				}
+void Model::CreateMeshes(const vector<ModelCache::CachedMesh>& meshes)
+{
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		Mesh* newMesh = MeshRegistry::AcquireMesh(meshes[i].vertices, meshes[i].indices, meshes[i].vertexCount, meshes[i].indexCount,
+			meshes[i].lodCount, meshes[i].lodIndexCount);
+		meshList.push_back(newMesh);
+		lodCount = newMesh->GetLodCount() > lodCount ? newMesh->GetLodCount() : lodCount;
+		meshToTex.push_back(meshes[i].materialIndex);
+	}
+}
+
+void Model::LoadMaterials(const vector<string>& materialTextures)
+{
+	textureList.resize(materialTextures.size());
+
+	for (size_t i = 0; i < materialTextures.size(); i++)
+	{
+		textureList[i] = nullptr;
+
+		if (!materialTextures[i].empty())
+		{
+			textureList[i] = TextureCache::AcquireTexture(materialTextures[i], false);
+
+			if (!textureList[i])
+			{
+				printf("Failed to load texture at: %s\n", materialTextures[i].c_str());
 			}
 		}
 
 		if (!textureList[i])
 		{
-			textureList[i] = new Texture("Textures/plain.png");
-			textureList[i]->LoadTextureA();
+			textureList[i] = TextureCache::AcquireTexture("Textures/plain.png", true);
+		}
+	}
+}
+
+void Model::CalculateBounds(const vector<ModelCache::CachedMesh>& meshes)
+{
+	meshBoundCenter.clear();
+	meshBoundRadius.clear();
+	meshBoundMin.clear();
+	meshBoundMax.clear();
+
+	boundMin = glm::vec3(FLT_MAX);
+	boundMax = glm::vec3(-FLT_MAX);
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+		for (unsigned int v = 0; v < meshes[i].vertexCount; v++)
+		{
+			glm::vec3 position = VertexPacking::GetPosition(meshes[i].vertices[v]);
+			minimum = glm::min(minimum, position);
+			maximum = glm::max(maximum, position);
 		}
+
+		if (minimum.x > maximum.x)
+		{
+			minimum = maximum = glm::vec3(0.0f, 0.0f, 0.0f);
+		}
+
+		//Centre each sphere on its box, then grow it to reach the farthest vertex.
+		glm::vec3 center = (minimum + maximum) * 0.5f;
+		GLfloat radius = 0.0f;
+		for (unsigned int v = 0; v < meshes[i].vertexCount; v++)
+		{
+			glm::vec3 position = VertexPacking::GetPosition(meshes[i].vertices[v]);
+			radius = glm::max(radius, glm::length(position - center));
+		}
+
+		meshBoundCenter.push_back(center);
+		meshBoundRadius.push_back(radius);
+		meshBoundMin.push_back(minimum);
+		meshBoundMax.push_back(maximum);
+
+		boundMin = glm::min(boundMin, minimum);
+		boundMax = glm::max(boundMax, maximum);
+	}
+
+	if (meshes.empty())
+	{
+		boundMin = boundMax = glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+
+	//The model's sphere encloses every mesh sphere around the model's box centre.
+	boundCenter = (boundMin + boundMax) * 0.5f;
+	boundRadius = 0.0f;
+	for (size_t i = 0; i < meshBoundCenter.size(); i++)
+	{
+		boundRadius = glm::max(boundRadius, glm::length(meshBoundCenter[i] - boundCenter) + meshBoundRadius[i]);
+	}
+}
+
+unsigned int Model::GetTriangleCount(unsigned int lod)
+{
+	unsigned int triangles = 0;
+	for (size_t i = 0; i < meshList.size(); i++)
+	{
+		triangles += GetMeshTriangles(i, lod);
+	}
+
+	return triangles;
+}
+
+unsigned int Model::SelectLod(GLfloat screenSize, unsigned int currentLod)
+{
+	unsigned int lod = currentLod < lodCount ? currentLod : (lodCount > 0 ? lodCount - 1 : 0);
+	while (lod + 1 < lodCount && screenSize < lodScreenSize[lod + 1])
+	{
+		lod++;
+	}
+	while (lod > 0 && screenSize > lodScreenSize[lod] * lodHysteresis)
+	{
+		lod--;
+	}
+
+	return lod;
+}
+
+void Model::CullMeshes(const Frustum& frustum, const glm::mat4& transform, vector<unsigned char>& meshVisible)
+{
+	meshVisible.resize(meshList.size());
+	for (size_t i = 0; i < meshList.size(); i++)
+	{
+		meshVisible[i] = frustum.TestBox(meshBoundMin[i], meshBoundMax[i], transform) ? 1 : 0;
 	}
 }
 
@@ -126,7 +376,7 @@ void Model::ClearModel()
 	{
 		if (meshList[i])
 		{
-			delete meshList[i];
+			MeshRegistry::ReleaseMesh(meshList[i]);
 			meshList[i] = nullptr;
 		}
 	}
@@ -135,7 +385,7 @@ void Model::ClearModel()
 	{
 		if (textureList[i])
 		{
-			delete textureList[i];
+			TextureCache::ReleaseTexture(textureList[i]);
 			textureList[i] = nullptr;
 		}
 	}
@@ -8,8 +8,16 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <glm\glm.hpp>
+
 #include "Mesh.h"
+#include "Frustum.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshRegistry.h"
+#include "ModelCache.h"
 #include "Texture.h"
+#include "TextureCache.h"
 
 using namespace std;
 
@@ -18,20 +26,68 @@ class Model
 public:
 	Model();
 
-	void LoadModel(const string& fileName);
-	void RenderModel();
+	void LoadModel(const string& fileName, bool loadMaterials = true);
 	void ClearModel();
 
+	//Bounds of the whole model in model space, used to cull the model.
+	glm::vec3 GetBoundCenter() { return boundCenter; }
+	GLfloat GetBoundRadius() { return boundRadius; }
+	glm::vec3 GetBoundMin() { return boundMin; }
+	glm::vec3 GetBoundMax() { return boundMax; }
+
+	size_t GetMeshCount() { return meshList.size(); }
+	Mesh* GetMesh(size_t mesh) { return meshList[mesh]; }
+	Texture* GetMeshTexture(size_t mesh); //nullptr when the mesh has none.
+	unsigned int GetMeshTriangles(size_t mesh, unsigned int lod = 0) { return meshList[mesh]->GetIndexCount(lod) / 3; }
+	unsigned int GetTriangleCount(unsigned int lod = 0);
+
+	//Levels of detail of the most detailed mesh, meshes with fewer repeat their last one.
+	unsigned int GetLodCount() { return lodCount; }
+	//The level for a projected bounding sphere diameter in pixels, given the level used last frame.
+	//Moving back to a finer level takes a margin, so a size hovering on a threshold does not flip every frame.
+	unsigned int SelectLod(GLfloat screenSize, unsigned int currentLod);
+
+	//Tests each mesh's box, so a model partly in view only draws the meshes that are.
+	void CullMeshes(const Frustum& frustum, const glm::mat4& transform, vector<unsigned char>& meshVisible);
+
 	~Model();
 
 private:
-	void LoadNode(aiNode *node, const aiScene *scene);
-	void LoadMesh(aiMesh *mesh, const aiScene *scene);
-	void LoadMaterials(const aiScene *scene);
+	//Packed arrays built from one Assimp mesh (or a piece of one too big for 16-bit indices),
+	//kept until they are uploaded and cached.
+	struct ImportedMesh
+	{
+		vector<PackedVertex> vertices;
+		vector<PackedIndex> indices;	//LOD 0, then the simplified levels once GenerateLods has run.
+		unsigned int lodCount;
+		unsigned int lodIndexCount[Mesh::MAX_LODS];
+		unsigned int materialIndex;
+	};
+
+	bool ImportModel(const string& fileName, vector<ImportedMesh>& imported, vector<string>& materialTextures);
+	void LoadNode(aiNode *node, const aiScene *scene, vector<ImportedMesh>& imported);
+	void LoadMesh(aiMesh *mesh, const aiScene *scene, vector<ImportedMesh>& imported);
+	void GetMaterialTextures(const aiScene *scene, vector<string>& materialTextures);
+	void GenerateLods(ImportedMesh& mesh);
+
+	void CreateMeshes(const vector<ModelCache::CachedMesh>& meshes);
+	void LoadMaterials(const vector<string>& materialTextures);
+	void CalculateBounds(const vector<ModelCache::CachedMesh>& meshes);
 
 	vector<Mesh*>meshList;
 	vector<Texture*>textureList;
 	vector<unsigned int> meshToTex;
+	unsigned int lodCount;
+
+	glm::vec3 boundCenter;
+	GLfloat boundRadius;
+	glm::vec3 boundMin, boundMax;
+
+	//Per-mesh bounds in model space.
+	vector<glm::vec3> meshBoundCenter;
+	vector<GLfloat> meshBoundRadius;
+	vector<glm::vec3> meshBoundMin;
+	vector<glm::vec3> meshBoundMax;
 
 
 };
@@ -0,0 +1,342 @@
+#include "ModelCache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+static const char cacheMagic[4] = { 'S', 'S', 'M', 'C' };
+
+//Everything after the header is made of 4-byte words so the arrays can be used in place.
+static size_t Padded(size_t size)
+{
+	return (size + 3) & ~(size_t)3;
+}
+
+ModelCache::ModelCache()
+{
+	data = nullptr;
+	dataSize = 0;
+
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+	fileDescriptor = -1;
+}
+
+bool ModelCache::Open(const string& sourceFile)
+{
+	Close();
+
+	if (!Map(GetCachePath(sourceFile)))
+	{
+		return false;
+	}
+
+	if (!Parse(sourceFile))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool ModelCache::Map(const string& fileName)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(Header))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	dataSize = (size_t)size.QuadPart;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header))
+	{
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view == MAP_FAILED)
+	{
+		close(fd);
+		return false;
+	}
+
+	fileDescriptor = fd;
+	data = (const unsigned char*)view;
+	dataSize = (size_t)info.st_size;
+#endif
+
+	return true;
+}
+
+bool ModelCache::Parse(const string& sourceFile)
+{
+	const Header* header = (const Header*)data;
+
+	if (memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != VERSION)
+	{
+		printf("Model cache (%s) has an old format, rebuilding\n", sourceFile.c_str());
+		return false;
+	}
+
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (!GetSourceInfo(sourceFile, sourceSize, sourceTime) || sourceSize != header->sourceSize)
+	{
+		printf("Model cache (%s) is stale, rebuilding\n", sourceFile.c_str());
+		return false;
+	}
+
+	//A touched but unchanged source (fresh checkout, copy) is still a hit if its contents match.
+	if (sourceTime != header->sourceTime)
+	{
+		uint64_t sourceHash;
+		if (!HashSource(sourceFile, sourceHash) || sourceHash != header->sourceHash)
+		{
+			printf("Model cache (%s) is stale, rebuilding\n", sourceFile.c_str());
+			return false;
+		}
+	}
+
+	size_t offset = sizeof(Header);
+
+	for (uint32_t i = 0; i < header->materialCount; i++)
+	{
+		if (offset + sizeof(uint32_t) > dataSize)
+		{
+			return false;
+		}
+
+		uint32_t length = *(const uint32_t*)(data + offset);
+		offset += sizeof(uint32_t);
+
+		if (offset + length > dataSize)
+		{
+			return false;
+		}
+
+		materialTextures.push_back(string((const char*)data + offset, length));
+		offset += Padded(length);
+	}
+
+	//Per mesh: material, vertex count, LOD count and MAX_LODS index counts, then the arrays.
+	const size_t countWords = 3 + Mesh::MAX_LODS;
+
+	for (uint32_t i = 0; i < header->meshCount; i++)
+	{
+		if (offset + countWords * sizeof(uint32_t) > dataSize)
+		{
+			return false;
+		}
+
+		const uint32_t* counts = (const uint32_t*)(data + offset);
+		offset += countWords * sizeof(uint32_t);
+
+		CachedMesh mesh;
+		mesh.materialIndex = counts[0];
+		mesh.vertexCount = counts[1];
+		mesh.lodCount = counts[2];
+		mesh.indexCount = 0;
+
+		if (mesh.lodCount < 1 || mesh.lodCount > Mesh::MAX_LODS)
+		{
+			return false;
+		}
+
+		for (unsigned int l = 0; l < Mesh::MAX_LODS; l++)
+		{
+			mesh.lodIndexCount[l] = counts[3 + l];
+			mesh.indexCount += l < mesh.lodCount ? mesh.lodIndexCount[l] : 0;
+		}
+
+		size_t vertexBytes = sizeof(PackedVertex) * (size_t)mesh.vertexCount;
+		size_t indexBytes = sizeof(PackedIndex) * (size_t)mesh.indexCount;
+		if (offset + vertexBytes + Padded(indexBytes) > dataSize)
+		{
+			return false;
+		}
+
+		mesh.vertices = (const PackedVertex*)(data + offset);
+		offset += vertexBytes;
+		mesh.indices = (const PackedIndex*)(data + offset);
+		offset += Padded(indexBytes);
+
+		meshes.push_back(mesh);
+	}
+
+	return true;
+}
+
+bool ModelCache::Write(const string& sourceFile, const vector<CachedMesh>& meshes, const vector<string>& materialTextures)
+{
+	Header header;
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = VERSION;
+	header.meshCount = meshes.size();
+	header.materialCount = materialTextures.size();
+
+	if (!GetSourceInfo(sourceFile, header.sourceSize, header.sourceTime) || !HashSource(sourceFile, header.sourceHash))
+	{
+		return false;
+	}
+
+	//Write beside the real file and swap it in, so an interrupted run never leaves half a cache.
+	string cachePath = GetCachePath(sourceFile);
+	string tempPath = cachePath + ".tmp";
+
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+	{
+		printf("Failed to write model cache %s\n", cachePath.c_str());
+		return false;
+	}
+
+	const char padding[4] = { 0, 0, 0, 0 };
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+	for (size_t i = 0; ok && i < materialTextures.size(); i++)
+	{
+		uint32_t length = materialTextures[i].size();
+		ok = fwrite(&length, sizeof(length), 1, file) == 1
+			&& fwrite(materialTextures[i].data(), 1, length, file) == length
+			&& fwrite(padding, 1, Padded(length) - length, file) == Padded(length) - length;
+	}
+
+	for (size_t i = 0; ok && i < meshes.size(); i++)
+	{
+		uint32_t counts[3 + Mesh::MAX_LODS] = { meshes[i].materialIndex, meshes[i].vertexCount, meshes[i].lodCount };
+		for (unsigned int l = 0; l < Mesh::MAX_LODS; l++)
+		{
+			counts[3 + l] = l < meshes[i].lodCount ? meshes[i].lodIndexCount[l] : 0;
+		}
+
+		size_t indexBytes = sizeof(PackedIndex) * meshes[i].indexCount;
+		ok = fwrite(counts, sizeof(counts), 1, file) == 1
+			&& fwrite(meshes[i].vertices, sizeof(PackedVertex), meshes[i].vertexCount, file) == meshes[i].vertexCount
+			&& fwrite(meshes[i].indices, sizeof(PackedIndex), meshes[i].indexCount, file) == meshes[i].indexCount
+			&& fwrite(padding, 1, Padded(indexBytes) - indexBytes, file) == Padded(indexBytes) - indexBytes;
+	}
+
+	ok = fclose(file) == 0 && ok;
+
+	remove(cachePath.c_str());
+	if (!ok || rename(tempPath.c_str(), cachePath.c_str()) != 0)
+	{
+		remove(tempPath.c_str());
+		printf("Failed to write model cache %s\n", cachePath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool ModelCache::GetSourceInfo(const string& sourceFile, uint64_t& size, int64_t& time)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(sourceFile.c_str(), &info) != 0)
+#else
+	struct stat info;
+	if (stat(sourceFile.c_str(), &info) != 0)
+#endif
+	{
+		return false;
+	}
+
+	size = (uint64_t)info.st_size;
+	time = (int64_t)info.st_mtime;
+	return true;
+}
+
+bool ModelCache::HashSource(const string& sourceFile, uint64_t& hash)
+{
+	FILE* file = fopen(sourceFile.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	hash = HASH_SEED;
+
+	unsigned char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		hash = HashBytes(buffer, read, hash);
+	}
+
+	fclose(file);
+	return true;
+}
+
+void ModelCache::Close()
+{
+	meshes.clear();
+	materialTextures.clear();
+
+	if (!data)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)mappingHandle);
+	CloseHandle((HANDLE)fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	munmap((void*)data, dataSize);
+	close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+
+	data = nullptr;
+	dataSize = 0;
+}
+
+ModelCache::~ModelCache()
+{
+	Close();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+
+#include <GL\glew.h>
+
+#include "Hash.h"
+#include "VertexLayout.h"
+#include "Mesh.h"
+
+using namespace std;
+
+//Binary copy of what Model builds from Assimp: the packed vertex and 16-bit index arrays (every LOD)
+//of every mesh plus the texture of every material, stored next to the source file.
+//Reading it maps the file and hands the arrays out in place, no parsing involved.
+class ModelCache
+{
+public:
+	struct CachedMesh
+	{
+		const PackedVertex* vertices;
+		const PackedIndex* indices;	//Every LOD back to back, as Mesh::CreateMesh takes them.
+		unsigned int vertexCount;
+		unsigned int indexCount;
+		unsigned int lodCount;
+		unsigned int lodIndexCount[Mesh::MAX_LODS];
+		unsigned int materialIndex;
+	};
+
+	ModelCache();
+
+	bool Open(const string& sourceFile);
+	void Close();
+
+	const vector<CachedMesh>& GetMeshes() { return meshes; }
+	const vector<string>& GetMaterialTextures() { return materialTextures; }
+
+	static bool Write(const string& sourceFile, const vector<CachedMesh>& meshes, const vector<string>& materialTextures);
+	static string GetCachePath(const string& sourceFile) { return sourceFile + ".meshcache"; }
+
+	~ModelCache();
+
+private:
+	//Bump whenever the file layout, the vertex format or the mesh optimization done by Model changes.
+	static const uint32_t VERSION = 4;
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint64_t sourceHash;
+		uint32_t meshCount;
+		uint32_t materialCount;
+	};
+
+	static bool GetSourceInfo(const string& sourceFile, uint64_t& size, int64_t& time);
+	static bool HashSource(const string& sourceFile, uint64_t& hash);
+
+	bool Map(const string& fileName);
+	bool Parse(const string& sourceFile);
+
+	const unsigned char* data;
+	size_t dataSize;
+
+	//Platform handles for the mapping, a HANDLE pair on Windows and a descriptor elsewhere.
+	void* fileHandle;
+	void* mappingHandle;
+	int fileDescriptor;
+
+	vector<CachedMesh> meshes;
+	vector<string> materialTextures;
+};
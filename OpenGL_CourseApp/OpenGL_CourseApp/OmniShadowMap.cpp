@@ -4,6 +4,17 @@
 
 OmniShadowMap::OmniShadowMap() : ShadowMap()
 {
+	staticFBO = 0;
+	staticMap = 0;
+	faceFBO = 0;
+	copyFBOs[0] = 0;
+	copyFBOs[1] = 0;
+	staticValid = false;
+
+	hasKey = false;
+	keyPosition = glm::vec3(0.0f);
+	keyFarPlane = 0.0f;
+	keyVersion = 0;
 }
 
 bool OmniShadowMap::Init(GLuint width, GLuint height)
@@ -11,8 +22,17 @@ bool OmniShadowMap::Init(GLuint width, GLuint height)
 	shadowWidth = width; shadowHeight = height;
 	glGenFramebuffers(1, &FBO);
 
-	glGenTextures(1, &shadowMap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, shadowMap);
+	shadowMap = CreateCubeMap();
+
+	return AttachCubeMap(FBO, shadowMap);
+}
+
+GLuint OmniShadowMap::CreateCubeMap()
+{
+	GLuint cubeMap = 0;
+
+	glGenTextures(1, &cubeMap);
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
 
 	for (size_t i = 0; i < 6; i++)
 	{
@@ -27,8 +47,13 @@ bool OmniShadowMap::Init(GLuint width, GLuint height)
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 	//Texture Parameters filter:
 
-	glBindFramebuffer(GL_FRAMEBUFFER,FBO);
-	glFramebufferTexture(GL_FRAMEBUFFER,GL_DEPTH_ATTACHMENT,shadowMap,0);
+	return cubeMap;
+}
+
+bool OmniShadowMap::AttachCubeMap(GLuint framebuffer, GLuint cubeMap)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubeMap, 0);
 
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
@@ -49,12 +74,123 @@ void OmniShadowMap::Write()
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
 }
 
+void OmniShadowMap::WriteFace(GLuint face)
+{
+	BindFace(shadowMap, face);
+}
+
+void OmniShadowMap::BindFace(GLuint cubeMap, GLuint face)
+{
+	bool created = faceFBO == 0;
+	if (created)
+	{
+		//Both read and draw, so glReadBuffer lands on this framebuffer too.
+		glGenFramebuffers(1, &faceFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, faceFBO);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, faceFBO);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cubeMap, 0);
+
+	//Later faces are the same format and size, checking the first is enough.
+	if (created)
+	{
+		GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+		if (status != GL_FRAMEBUFFER_COMPLETE)
+		{
+			cout << "Face Framebuffer Error:\t" << status << endl;
+		}
+	}
+}
+
 void OmniShadowMap::Read(GLenum textureUnit)
 {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, shadowMap);
+	GLState::BindTexture(textureUnit, GL_TEXTURE_CUBE_MAP, shadowMap);
+}
+
+bool OmniShadowMap::UpdateCacheKey(glm::vec3 lightPosition, GLfloat farPlane, unsigned int casterVersion)
+{
+	bool unchanged = hasKey && keyPosition == lightPosition && keyFarPlane == farPlane && keyVersion == casterVersion;
+
+	hasKey = true;
+	keyPosition = lightPosition;
+	keyFarPlane = farPlane;
+	keyVersion = casterVersion;
+
+	if (!unchanged)
+	{
+		staticValid = false;
+	}
+
+	return unchanged;
+}
+
+void OmniShadowMap::WriteStatic()
+{
+	//Only lights that hold still ever get a cache.
+	if (staticFBO == 0)
+	{
+		glGenFramebuffers(1, &staticFBO);
+		staticMap = CreateCubeMap();
+		AttachCubeMap(staticFBO, staticMap);
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, staticFBO);
+}
+
+void OmniShadowMap::WriteStaticFace(GLuint face)
+{
+	BindFace(staticMap, face);
+}
+
+void OmniShadowMap::CopyStatic()
+{
+	if (GLEW_VERSION_4_3 || GLEW_ARB_copy_image)
+	{
+		glCopyImageSubData(staticMap, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+			shadowMap, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0, shadowWidth, shadowHeight, 6);
+		return;
+	}
+
+	//Blits only touch layer zero of a layered attachment, so copy face by face.
+	if (copyFBOs[0] == 0)
+	{
+		glGenFramebuffers(2, copyFBOs);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, copyFBOs[0]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, copyFBOs[1]);
+	glReadBuffer(GL_NONE);
+	glDrawBuffer(GL_NONE);
+
+	for (size_t i = 0; i < 6; i++)
+	{
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, staticMap, 0);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, shadowMap, 0);
+		glBlitFramebuffer(0, 0, shadowWidth, shadowHeight, 0, 0, shadowWidth, shadowHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
 }
 
 OmniShadowMap::~OmniShadowMap()
 {
+	if (staticFBO)
+	{
+		glDeleteFramebuffers(1, &staticFBO);
+		GLState::ForgetTexture(staticMap);
+		glDeleteTextures(1, &staticMap);
+	}
+
+	if (faceFBO)
+	{
+		glDeleteFramebuffers(1, &faceFBO);
+	}
+
+	if (copyFBOs[0])
+	{
+		glDeleteFramebuffers(2, copyFBOs);
+	}
 }
@@ -1,6 +1,8 @@
 #pragma once
 #include "ShadowMap.h"
 
+#include <glm\glm.hpp>
+
 class OmniShadowMap :
 	public ShadowMap
 {
@@ -9,8 +11,33 @@ public:
 
 	bool Init(GLuint width, GLuint height);
 	void Write();
+	void WriteFace(GLuint face);	//One face only, for drawing without layered rendering.
 	void Read(GLenum textureUnit);
 
+	//Static caster cache: a second cube map holding only the geometry that never moves,
+	//copied into the shadow map each frame before the moving casters are drawn on top.
+	//Returns false, and drops the cache, if the light or the static casters changed since last frame.
+	bool UpdateCacheKey(glm::vec3 lightPosition, GLfloat farPlane, unsigned int casterVersion);
+	bool IsStaticCacheValid() { return staticValid; }
+	void WriteStatic();
+	void WriteStaticFace(GLuint face);
+	void FinishStatic() { staticValid = true; }
+	void CopyStatic();
+
 	~OmniShadowMap();
-};
 
+private:
+	GLuint CreateCubeMap();
+	bool AttachCubeMap(GLuint framebuffer, GLuint cubeMap);
+	void BindFace(GLuint cubeMap, GLuint face);
+
+	GLuint staticFBO, staticMap;
+	GLuint faceFBO;
+	GLuint copyFBOs[2];	//Read and draw, one face at a time when glCopyImageSubData is missing.
+	bool staticValid;
+
+	bool hasKey;
+	glm::vec3 keyPosition;
+	GLfloat keyFarPlane;
+	unsigned int keyVersion;
+};
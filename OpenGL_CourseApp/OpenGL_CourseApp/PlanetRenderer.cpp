@@ -0,0 +1,121 @@
+#include "PlanetRenderer.h"
+
+PlanetRenderer::PlanetRenderer()
+{
+	sphereLoaded = false;
+	textureArrayID = 0;
+}
+
+void PlanetRenderer::LoadSphere(const string& fileName)
+{
+	//Geometry only, the textures live in the texture array.
+	sphere.LoadModel(fileName, false);
+	sphereLoaded = true;
+}
+
+int PlanetRenderer::AddPlanet(const string& textureLocation)
+{
+	for (size_t i = 0; i < textureLocations.size(); i++)
+	{
+		if (textureLocations[i] == textureLocation) return i;
+	}
+
+	textureLocations.push_back(textureLocation);
+	return textureLocations.size() - 1;
+}
+
+bool PlanetRenderer::CreateTextureArray()
+{
+	if (textureLocations.empty())
+	{
+		return true;
+	}
+
+	if (CreateTextureArrayKtx())
+	{
+		return true;
+	}
+
+	glGenTextures(1, &textureArrayID);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, textureArrayID);
+
+	//One white texel per layer until the worker pool has decoded the planets.
+	vector<unsigned char> placeholder(3 * textureLocations.size(), 255);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, 1, 1, textureLocations.size(), 0, GL_RGB, GL_UNSIGNED_BYTE, &placeholder[0]);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	TextureLoader::LoadAsync(textureLocations, 3, textureArrayID, GL_TEXTURE_2D_ARRAY);
+
+	return true;
+}
+
+bool PlanetRenderer::CreateTextureArrayKtx()
+{
+	if (!KtxFile::IsSupported())
+	{
+		return false;
+	}
+
+	//Every planet must be cooked to the same size and format to share the array.
+	vector<KtxFile> layers(textureLocations.size());
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		if (!layers[i].LoadCooked(textureLocations[i]) || layers[i].GetFaceCount() != 1
+			|| !layers[i].IsCompatible(layers[0]))
+		{
+			return false;
+		}
+	}
+
+	glGenTextures(1, &textureArrayID);
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, textureArrayID);
+
+	layers[0].AllocateArray(layers.size());
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		layers[i].UploadLayer(i);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, layers[0].GetLevelCount() - 1);
+
+	GLState::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return true;
+}
+
+void PlanetRenderer::UseTextureArray()
+{
+	GLState::BindTexture(GL_TEXTURE0 + PLANET_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, textureArrayID);
+}
+
+void PlanetRenderer::ClearPlanets()
+{
+	sphere.ClearModel();
+	sphereLoaded = false;
+
+	if (textureArrayID != 0)
+	{
+		TextureLoader::Cancel(textureArrayID);
+		GLState::ForgetTexture(textureArrayID);
+		glDeleteTextures(1, &textureArrayID);
+		textureArrayID = 0;
+	}
+
+	textureLocations.clear();
+}
+
+PlanetRenderer::~PlanetRenderer()
+{
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <GL\glew.h>
+
+#include "CommonValues.h"
+#include "GLState.h"
+#include "Model.h"
+#include "KtxFile.h"
+
+using namespace std;
+
+class PlanetRenderer
+{
+public:
+	PlanetRenderer();
+
+	void LoadSphere(const string& fileName);
+	int AddPlanet(const string& textureLocation); //Returns the planet's texture array layer.
+	bool CreateTextureArray();
+
+	//Planets draw through the render queue with the sphere's meshes, this binds their textures.
+	void UseTextureArray();
+	GLuint GetTextureArray() { return textureArrayID; }
+
+	bool HasSphere() { return sphereLoaded; }
+	Model& GetSphere() { return sphere; }
+
+	void ClearPlanets();
+
+	~PlanetRenderer();
+
+private:
+	bool CreateTextureArrayKtx();
+
+	Model sphere;
+	bool sphereLoaded;
+
+	vector<string> textureLocations;
+
+	GLuint textureArrayID;
+};
@@ -29,18 +29,13 @@ PointLight::PointLight(GLfloat shadowWidth, GLfloat shadowHeight,
 	shadowMap->Init(shadowWidth, shadowHeight);
 }
 
-void PointLight::UseLight(GLuint ambientIntensityLocation, GLuint ambientColourLocation,
-	GLuint diffuseIntensityLocation, GLuint positionLocation,
-	GLuint constantLocation, GLuint linearLocation, GLuint exponentLocation)
+void PointLight::WriteBlock(PointLightBlock& block)
 {
-	glUniform3f(ambientColourLocation, colour.x, colour.y, colour.z);
-	glUniform1f(ambientIntensityLocation, ambientIntensity);
-	glUniform1f(diffuseIntensityLocation, diffuseIntensity);
-
-	glUniform3f(positionLocation, position.x, position.y, position.z);
-	glUniform1f(constantLocation, constant);
-	glUniform1f(linearLocation, linear);
-	glUniform1f(exponentLocation, exponent);
+	Light::WriteBlock(block.base);
+	block.position = position;
+	block.constant = constant;
+	block.linear = linear;
+	block.exponent = exponent;
 }
 
 std::vector<glm::mat4> PointLight::CalculateLightTransform()
@@ -17,9 +17,7 @@ public:
 				GLfloat xPos, GLfloat yPos, GLfloat zPos,
 				GLfloat con, GLfloat lin, GLfloat exp);
 
-	void UseLight(GLuint ambientIntensityLocation, GLuint ambientColourLocation,
-		GLuint diffuseIntensityLocation, GLuint positionLocation,
-		GLuint constantLocation, GLuint linearLocation, GLuint exponentLocation);
+	void WriteBlock(PointLightBlock& block);
 
 	vector<glm::mat4> CalculateLightTransform();
 
@@ -27,6 +25,8 @@ public:
 
 	glm::vec3 GetPosition();
 
+	OmniShadowMap* GetOmniShadowMap() { return (OmniShadowMap*)shadowMap; }
+
 	~PointLight();
 
 protected:
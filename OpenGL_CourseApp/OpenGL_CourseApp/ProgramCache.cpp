@@ -0,0 +1,149 @@
+#include "ProgramCache.h"
+
+static const char cacheMagic[4] = { 'S', 'S', 'P', 'B' };
+
+unsigned int ProgramCache::hits = 0;
+unsigned int ProgramCache::misses = 0;
+
+bool ProgramCache::IsSupported()
+{
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+	{
+		return false;
+	}
+
+	//Some drivers expose the entry points but no binary formats.
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+uint64_t ProgramCache::MakeKey(const char* vertexCode, const char* geometryCode, const char* fragmentCode)
+{
+	const char* driver[3] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+	const char* sources[3] = { vertexCode, geometryCode ? geometryCode : "", fragmentCode };
+
+	//Each string hashes its terminator too, so moving text between stages changes the key.
+	uint64_t key = HASH_SEED;
+	for (int i = 0; i < 3; i++)
+	{
+		key = HashBytes(driver[i] ? driver[i] : "", driver[i] ? strlen(driver[i]) + 1 : 1, key);
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		key = HashBytes(sources[i], strlen(sources[i]) + 1, key);
+	}
+
+	return key;
+}
+
+string ProgramCache::GetCachePath(uint64_t key)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "Shaders/%016llx.programbin", (unsigned long long)key);
+	return name;
+}
+
+bool ProgramCache::Load(GLuint program, uint64_t key)
+{
+	if (!IsSupported())
+	{
+		return false;
+	}
+
+	FILE* file = fopen(GetCachePath(key).c_str(), "rb");
+	if (!file)
+	{
+		misses++;
+		return false;
+	}
+
+	Header header;
+	vector<unsigned char> binary;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0
+		&& header.version == VERSION && header.key == key && header.length > 0;
+
+	if (ok)
+	{
+		binary.resize(header.length);
+		ok = fread(&binary[0], 1, header.length, file) == header.length;
+	}
+	fclose(file);
+
+	if (!ok)
+	{
+		misses++;
+		return false;
+	}
+
+	//The driver can still reject a binary it wrote, e.g. after a silent update.
+	glProgramBinary(program, header.format, &binary[0], header.length);
+
+	GLint linked = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		misses++;
+		return false;
+	}
+
+	hits++;
+	return true;
+}
+
+bool ProgramCache::Save(GLuint program, uint64_t key)
+{
+	if (!IsSupported())
+	{
+		return false;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return false;
+	}
+
+	Header header;
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = VERSION;
+	header.key = key;
+
+	vector<unsigned char> binary(length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, &binary[0]);
+	if (written <= 0)
+	{
+		return false;
+	}
+	header.format = format;
+	header.length = written;
+
+	//Write beside the real file and swap it in, so an interrupted run never leaves half a binary.
+	string cachePath = GetCachePath(key);
+	string tempPath = cachePath + ".tmp";
+
+	FILE* file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+	{
+		printf("Failed to write program cache %s\n", cachePath.c_str());
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(&binary[0], 1, written, file) == (size_t)written;
+	ok = fclose(file) == 0 && ok;
+
+	remove(cachePath.c_str());
+	if (!ok || rename(tempPath.c_str(), cachePath.c_str()) != 0)
+	{
+		remove(tempPath.c_str());
+		printf("Failed to write program cache %s\n", cachePath.c_str());
+		return false;
+	}
+
+	return true;
+}
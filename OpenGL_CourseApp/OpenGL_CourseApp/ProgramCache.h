@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+
+#include <GL\glew.h>
+
+#include "Hash.h"
+
+using namespace std;
+
+//Linked program binaries saved with glGetProgramBinary and restored with glProgramBinary,
+//so later runs skip compiling and linking. A binary is keyed by the hash of its stage
+//sources plus the GL vendor, renderer and version, so a driver update or edited shader
+//simply misses and recompiles.
+class ProgramCache
+{
+public:
+	static bool IsSupported();
+
+	static uint64_t MakeKey(const char* vertexCode, const char* geometryCode, const char* fragmentCode);
+
+	static bool Load(GLuint program, uint64_t key); //Leaves the program unlinked on a miss.
+	static bool Save(GLuint program, uint64_t key);
+
+	static unsigned int GetHitCount() { return hits; }
+	static unsigned int GetMissCount() { return misses; }
+
+	static string GetCachePath(uint64_t key);
+
+private:
+	static const uint32_t VERSION = 1;
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	static unsigned int hits;
+	static unsigned int misses;
+};
@@ -0,0 +1,117 @@
+#include "RenderQueue.h"
+
+static const unsigned int DEPTH_BITS = 28;
+static const unsigned int MATERIAL_SHIFT = DEPTH_BITS;
+static const unsigned int TEXTURE_SHIFT = MATERIAL_SHIFT + 8;
+static const unsigned int PROGRAM_SHIFT = TEXTURE_SHIFT + 16;
+static const unsigned int PASS_SHIFT = PROGRAM_SHIFT + 8;
+
+RenderQueue::RenderQueue()
+{
+	pass = PASS_MAIN;
+	program = 0;
+}
+
+void RenderQueue::Begin(RenderPassID passID, GLuint programID)
+{
+	pass = passID;
+	program = programID;
+
+	packets.clear();
+	keys.clear();
+	indices.clear();
+}
+
+void RenderQueue::Submit(const DrawPacket& packet, GLuint texture, unsigned int material, GLfloat depth)
+{
+	keys.push_back(MakeKey(pass, program, texture, material, depth));
+	indices.push_back((uint32_t)packets.size());
+	packets.push_back(packet);
+}
+
+uint64_t RenderQueue::MakeKey(unsigned int pass, GLuint program, GLuint texture, unsigned int material, GLfloat depth)
+{
+	//Names wider than their field only cost some grouping, never correctness.
+	if (!(depth > 0.0f)) depth = 0.0f;
+	if (depth > 1.0f) depth = 1.0f;
+	uint64_t quantizedDepth = (uint64_t)(depth * (GLfloat)((1u << DEPTH_BITS) - 1));
+
+	return ((uint64_t)(pass & 0xF) << PASS_SHIFT) |
+		((uint64_t)(program & 0xFF) << PROGRAM_SHIFT) |
+		((uint64_t)(texture & 0xFFFF) << TEXTURE_SHIFT) |
+		((uint64_t)(material & 0xFF) << MATERIAL_SHIFT) |
+		quantizedDepth;
+}
+
+void RenderQueue::Sort()
+{
+	size_t count = keys.size();
+	sortedKeys.resize(count);
+	sortedIndices.resize(count);
+
+	if (count < 2)
+	{
+		sortedKeys = keys;
+		sortedIndices = indices;
+		return;
+	}
+
+	//LSD radix sort, a byte per pass. All eight histograms come from one read of the keys,
+	//and a byte every key shares is skipped, which is most of them within a pass.
+	unsigned int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = keys[i];
+		for (unsigned int digit = 0; digit < 8; digit++)
+		{
+			histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	uint64_t* sourceKeys = &keys[0];
+	uint32_t* sourceIndices = &indices[0];
+	uint64_t* targetKeys = &sortedKeys[0];
+	uint32_t* targetIndices = &sortedIndices[0];
+
+	for (unsigned int digit = 0; digit < 8; digit++)
+	{
+		unsigned int* histogram = histograms[digit];
+		unsigned int shift = digit * 8;
+
+		if (histogram[(sourceKeys[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		unsigned int offset = 0;
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			unsigned int bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned int position = histogram[(sourceKeys[i] >> shift) & 0xFF]++;
+			targetKeys[position] = sourceKeys[i];
+			targetIndices[position] = sourceIndices[i];
+		}
+
+		swap(sourceKeys, targetKeys);
+		swap(sourceIndices, targetIndices);
+	}
+
+	//Odd number of passes, or none at all, leaves the result in the submit arrays.
+	if (sourceKeys != &sortedKeys[0])
+	{
+		memcpy(&sortedKeys[0], sourceKeys, sizeof(uint64_t) * count);
+		memcpy(&sortedIndices[0], sourceIndices, sizeof(uint32_t) * count);
+	}
+}
+
+RenderQueue::~RenderQueue()
+{
+}
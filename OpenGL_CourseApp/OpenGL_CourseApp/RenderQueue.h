@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+#include "Mesh.h"
+#include "Texture.h"
+
+using namespace std;
+
+//Passes in the order a shared queue would execute them.
+enum RenderPassID
+{
+	PASS_DIRECTIONAL_SHADOW,
+	PASS_OMNI_SHADOW,
+	PASS_MAIN
+};
+
+//Draw packets sorted by a 64-bit key before they are executed, so draws sharing
+//a program, texture and material run back to back and opaque geometry goes
+//front to back within them. From the top bit down the key holds:
+//pass (4 bits), program (8), texture (16), material (8), depth (28).
+class RenderQueue
+{
+public:
+	//One mesh draw of instanceCount instances.
+	struct DrawPacket
+	{
+		Mesh* mesh;
+		Texture* texture;		//nullptr keeps whatever is bound.
+		bool textureArray;		//Instances pick a layer of the planet texture array.
+		unsigned int material;
+		const glm::mat4* transforms;	//One per instance, copied into the pass's buffer for indirect draws.
+		const GLfloat* layers;			//nullptr for layer 0.
+		GLsizei instanceCount;
+		GLuint instanceBuffer, layerBuffer; //Already holding them for direct draws, 0 draws once with transforms[0].
+		unsigned int lod;
+	};
+
+	RenderQueue();
+
+	void Begin(RenderPassID pass, GLuint program);
+	//depth is 0 at the viewer and 1 at the far end of the pass's volume.
+	void Submit(const DrawPacket& packet, GLuint texture, unsigned int material, GLfloat depth);
+	void Sort();
+
+	size_t GetCount() { return packets.size(); }
+	const DrawPacket& GetSorted(size_t i) { return packets[sortedIndices[i]]; }
+
+	static uint64_t MakeKey(unsigned int pass, GLuint program, GLuint texture, unsigned int material, GLfloat depth);
+
+	~RenderQueue();
+
+private:
+	vector<DrawPacket> packets;
+	vector<uint64_t> keys, sortedKeys;
+	vector<uint32_t> indices, sortedIndices;
+
+	RenderPassID pass;
+	GLuint program;
+};
@@ -0,0 +1,905 @@
+#include "Scene.h"
+
+#include <math.h>
+#include <cfloat>
+
+static const float toRadians = 3.14159265f / 180.0f;
+
+//Bodies smaller than this many pixels across contribute too little to draw.
+static const GLfloat minScreenSize = 1.0f;
+
+Scene::Scene()
+{
+	staticUploaded = false;
+	staticVersion = 0;
+	cullMeshes = false;
+	passStats = nullptr;
+	sortFromSphere = false;
+	indirectBuffer = indirectInstanceBuffer = indirectLayerBuffer = 0;
+}
+
+bool Scene::LoadScene(const char* fileLocation)
+{
+	std::ifstream fileStream(fileLocation, std::ios::in);
+
+	if (!fileStream.is_open())
+	{
+		printf("Failed to read %s! File doesn't exist.\n", fileLocation);
+		return false;
+	}
+
+	std::string line = "";
+	unsigned int lineNumber = 0;
+	while (std::getline(fileStream, line))
+	{
+		lineNumber++;
+
+		std::istringstream lineStream(line);
+		std::string type;
+		if (!(lineStream >> type) || type[0] == '#')
+		{
+			continue;
+		}
+
+		if (type == "model")
+		{
+			std::string name, file;
+			if (!(lineStream >> name >> file))
+			{
+				printf("Scene (%s) line %u: expected 'model <name> <file>'\n", fileLocation, lineNumber);
+				return false;
+			}
+
+			Model* model = new Model();
+			model->LoadModel(file);
+
+			modelNames.push_back(name);
+			modelList.push_back(model);
+			modelLayer.push_back(-1);
+		}
+		else if (type == "sphere")
+		{
+			std::string file;
+			if (!(lineStream >> file))
+			{
+				printf("Scene (%s) line %u: expected 'sphere <file>'\n", fileLocation, lineNumber);
+				return false;
+			}
+
+			planets.LoadSphere(file);
+		}
+		else if (type == "planet")
+		{
+			std::string name, texture;
+			if (!(lineStream >> name >> texture) || !planets.HasSphere())
+			{
+				printf("Scene (%s) line %u: expected 'planet <name> <texture>' after a sphere entry\n", fileLocation, lineNumber);
+				return false;
+			}
+
+			modelNames.push_back(name);
+			modelList.push_back(nullptr);
+			modelLayer.push_back(planets.AddPlanet(texture));
+		}
+		else if (type == "material")
+		{
+			std::string name;
+			GLfloat intensity, shine;
+			if (!(lineStream >> name >> intensity >> shine))
+			{
+				printf("Scene (%s) line %u: expected 'material <name> <intensity> <shininess>'\n", fileLocation, lineNumber);
+				return false;
+			}
+
+			materialNames.push_back(name);
+			materialList.push_back(Material(intensity, shine));
+		}
+		else if (type == "body")
+		{
+			std::string name, modelName, materialName, parentName;
+			GLfloat phase, period, radius, height, spinPeriod, tilt, scale;
+			glm::vec3 tiltAxis;
+			if (!(lineStream >> name >> modelName >> materialName >> parentName
+				>> phase >> period >> radius >> height >> spinPeriod
+				>> tilt >> tiltAxis.x >> tiltAxis.y >> tiltAxis.z >> scale))
+			{
+				printf("Scene (%s) line %u: malformed body\n", fileLocation, lineNumber);
+				return false;
+			}
+
+			int modelIndex = FindModel(modelName);
+			int materialIndex = FindMaterial(materialName);
+			int parentIndex = parentName == "-" ? -1 : FindBody(parentName);
+
+			if (modelIndex < 0 || materialIndex < 0 || (parentName != "-" && parentIndex < 0))
+			{
+				printf("Scene (%s) line %u: unknown model, material or parent for body '%s'\n", fileLocation, lineNumber, name.c_str());
+				return false;
+			}
+
+			bodyNames.push_back(name);
+			bodyParent.push_back(parentIndex);
+			bodyModel.push_back(modelIndex);
+			bodyMaterial.push_back(materialIndex);
+			bodyPhase.push_back(phase);
+			bodyRevolution.push_back(period != 0.0f ? 360.0f * toRadians / period : 0.0f);
+			bodyRadius.push_back(radius);
+			bodyHeight.push_back(height);
+			bodySpin.push_back(spinPeriod != 0.0f ? toRadians / spinPeriod : 0.0f);
+			bodyTilt.push_back(tilt);
+			bodyTiltAxis.push_back(tiltAxis);
+			bodyScale.push_back(scale);
+			bodyStatic.push_back(period == 0.0f && spinPeriod == 0.0f && (parentIndex < 0 || bodyStatic[parentIndex]));
+		}
+		else if (type == "light" || type == "lightring")
+		{
+			std::string parentName;
+			unsigned int count = 1;
+			GLfloat ringRadius = 0.0f;
+			glm::vec3 offset;
+			ClusteredLights::Light light;
+
+			bool parsed = type == "light"
+				? (bool)(lineStream >> parentName >> offset.x >> offset.y >> offset.z)
+				: (bool)(lineStream >> parentName >> count >> ringRadius >> offset.y);
+			if (!parsed || !(lineStream >> light.colour.x >> light.colour.y >> light.colour.z >> light.intensity >> light.range))
+			{
+				printf("Scene (%s) line %u: malformed %s\n", fileLocation, lineNumber, type.c_str());
+				return false;
+			}
+
+			int parentIndex = parentName == "-" ? -1 : FindBody(parentName);
+			if (parentName != "-" && parentIndex < 0)
+			{
+				printf("Scene (%s) line %u: unknown parent '%s'\n", fileLocation, lineNumber, parentName.c_str());
+				return false;
+			}
+
+			//A ring spreads its lights evenly around the parent.
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (type == "lightring")
+				{
+					GLfloat ringAngle = 360.0f * toRadians * i / count;
+					offset.x = cosf(ringAngle) * ringRadius;
+					offset.z = sinf(ringAngle) * ringRadius;
+				}
+
+				lightParent.push_back(parentIndex);
+				lightOffset.push_back(offset);
+				light.position = offset;
+				lights.push_back(light);
+			}
+		}
+		else
+		{
+			printf("Scene (%s) line %u: unknown entry '%s'\n", fileLocation, lineNumber, type.c_str());
+			return false;
+		}
+	}
+
+	fileStream.close();
+
+	planets.CreateTextureArray();
+
+	bodyFrame.resize(bodyModel.size());
+	bodyTransform.resize(bodyModel.size());
+	bodyBounds.resize(bodyModel.size());
+	bodyVisible.assign(bodyModel.size(), 1);
+	bodyLod.assign(bodyModel.size(), 0);
+	bodyScreenSize.assign(bodyModel.size(), FLT_MAX);
+
+	CreateBatches();
+
+	staticVersion++;
+
+	return true;
+}
+
+void Scene::CreateBatches()
+{
+	vector<vector<unsigned int>> groups;
+	vector<unsigned int> groupModel, groupMaterial;
+	vector<bool> groupStatic;
+
+	for (size_t i = 0; i < bodyModel.size(); i++)
+	{
+		size_t g = 0;
+		while (g < groups.size() && (groupModel[g] != bodyModel[i] || groupMaterial[g] != bodyMaterial[i] || groupStatic[g] != bodyStatic[i]))
+		{
+			g++;
+		}
+
+		if (g == groups.size())
+		{
+			groups.push_back(vector<unsigned int>());
+			groupModel.push_back(bodyModel[i]);
+			groupMaterial.push_back(bodyMaterial[i]);
+			groupStatic.push_back(bodyStatic[i]);
+		}
+
+		groups[g].push_back(i);
+	}
+
+	//All planets with the same material form one batch, whatever their texture.
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		if (modelLayer[groupModel[g]] < 0)
+		{
+			continue;
+		}
+
+		for (size_t h = g + 1; h < groups.size(); h++)
+		{
+			if (modelLayer[groupModel[h]] >= 0 && groupMaterial[h] == groupMaterial[g] && groupStatic[h] == groupStatic[g])
+			{
+				groups[g].insert(groups[g].end(), groups[h].begin(), groups[h].end());
+				groups[h].clear();
+			}
+		}
+	}
+
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		bool isPlanet = modelLayer[groupModel[g]] >= 0;
+
+		if (groups[g].empty())
+		{
+			continue;
+		}
+
+		if (groups[g].size() == 1 && !isPlanet)
+		{
+			singleBodies.push_back(groups[g][0]);
+			continue;
+		}
+
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * groups[g].size(), nullptr, GL_STREAM_DRAW);
+
+		//Texture layers never change, upload them once.
+		GLuint layerBuffer = 0;
+		if (isPlanet)
+		{
+			vector<GLfloat> layers;
+			for (size_t i = 0; i < groups[g].size(); i++)
+			{
+				layers.push_back((GLfloat)modelLayer[bodyModel[groups[g][i]]]);
+			}
+
+			glGenBuffers(1, &layerBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, layerBuffer);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * layers.size(), &layers[0], GL_STATIC_DRAW);
+		}
+
+		GLuint culledBuffers[Mesh::MAX_LODS] = {}, culledLayerBuffers[Mesh::MAX_LODS] = {};
+		glGenBuffers(Mesh::MAX_LODS, culledBuffers);
+		if (isPlanet)
+		{
+			glGenBuffers(Mesh::MAX_LODS, culledLayerBuffers);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		batchIsPlanet.push_back(isPlanet);
+		batchStatic.push_back(groupStatic[g]);
+		batchModel.push_back(groupModel[g]);
+		batchMaterial.push_back(groupMaterial[g]);
+		batchFirst.push_back(batchBodies.size());
+		batchCount.push_back(groups[g].size());
+		batchBuffer.push_back(buffer);
+		batchLayerBuffer.push_back(layerBuffer);
+		batchCulledBuffer.insert(batchCulledBuffer.end(), culledBuffers, culledBuffers + Mesh::MAX_LODS);
+		batchCulledLayerBuffer.insert(batchCulledLayerBuffer.end(), culledLayerBuffers, culledLayerBuffers + Mesh::MAX_LODS);
+		batchCulledCount.insert(batchCulledCount.end(), Mesh::MAX_LODS, 0);
+		batchCulledFirst.insert(batchCulledFirst.end(), Mesh::MAX_LODS, 0);
+		batchBodies.insert(batchBodies.end(), groups[g].begin(), groups[g].end());
+		for (size_t i = 0; i < groups[g].size(); i++)
+		{
+			batchLayers.push_back(isPlanet ? (GLfloat)modelLayer[bodyModel[groups[g][i]]] : 0.0f);
+		}
+	}
+
+	batchTransforms.resize(batchBodies.size());
+	staticUploaded = false;
+}
+
+void Scene::Update(GLfloat angle)
+{
+	const glm::vec3 yAxis(0.0f, 1.0f, 0.0f);
+
+	for (size_t i = 0; i < bodyModel.size(); i++)
+	{
+		glm::mat4 frame = bodyParent[i] < 0 ? glm::mat4() : bodyFrame[bodyParent[i]];
+		frame = glm::rotate(frame, bodyPhase[i], yAxis);
+		frame = glm::rotate(frame, bodyRevolution[i] * angle, yAxis);		//Revolution.
+		frame = glm::translate(frame, glm::vec3(bodyRadius[i], bodyHeight[i], 0.0f));
+		bodyFrame[i] = frame;
+
+		glm::mat4 model = glm::rotate(frame, bodySpin[i] * angle, yAxis);	//Spin.
+		model = glm::rotate(model, bodyTilt[i], bodyTiltAxis[i]);
+		model = glm::scale(model, glm::vec3(bodyScale[i]));
+		bodyTransform[i] = model;
+
+		//Scale the model's sphere by the largest axis scale so it still encloses the body.
+		Model& bounds = modelList[bodyModel[i]] ? *modelList[bodyModel[i]] : planets.GetSphere();
+		GLfloat maxScale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		bodyBounds[i] = glm::vec4(glm::vec3(model * glm::vec4(bounds.GetBoundCenter(), 1.0f)), bounds.GetBoundRadius() * maxScale);
+	}
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		lights[i].position = lightParent[i] < 0 ? lightOffset[i] : glm::vec3(bodyFrame[lightParent[i]] * glm::vec4(lightOffset[i], 1.0f));
+	}
+
+	//Upload instance matrices once per frame, every pass reuses them.
+	for (size_t i = 0; i < batchBodies.size(); i++)
+	{
+		batchTransforms[i] = bodyTransform[batchBodies[i]];
+	}
+
+	//Indirect draws copy the instances from batchTransforms themselves.
+	for (size_t b = 0; b < batchBuffer.size() && !GeometryArena::IsIndirectSupported(); b++)
+	{
+		if (batchStatic[b] && staticUploaded)
+		{
+			continue;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, batchBuffer[b]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * batchCount[b], nullptr, GL_STREAM_DRAW); //Orphan last frame's data.
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * batchCount[b], &batchTransforms[batchFirst[b]]);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	staticUploaded = true;
+}
+
+void Scene::SelectLods(glm::vec3 eyePosition, GLfloat pixelsPerUnit)
+{
+	for (size_t i = 0; i < bodyBounds.size(); i++)
+	{
+		Model& model = modelList[bodyModel[i]] ? *modelList[bodyModel[i]] : planets.GetSphere();
+
+		//As if the sphere were in the middle of the view, from the camera inside it it fills the screen.
+		GLfloat distance = glm::length(glm::vec3(bodyBounds[i]) - eyePosition);
+		bodyScreenSize[i] = distance > bodyBounds[i].w ? 2.0f * bodyBounds[i].w / distance * pixelsPerUnit : FLT_MAX;
+
+		unsigned int lod = model.SelectLod(bodyScreenSize[i], bodyLod[i]);
+		if (bodyStatic[i] && lod != bodyLod[i])
+		{
+			staticVersion++; //Cached shadows hold the old level.
+		}
+		bodyLod[i] = lod;
+	}
+}
+
+void Scene::RenderScene(GLuint uniformModel, GLuint uniformInstanced, GLuint uniformUseTextureArray,
+	GLuint uniformSpecularIntensity, GLuint uniformShininess, CasterSet casters, GLsizei views, bool culled,
+	RenderPassID pass)
+{
+	renderQueue.Begin(pass, GLState::GetProgram());
+
+	for (size_t i = 0; i < singleBodies.size(); i++)
+	{
+		unsigned int body = singleBodies[i];
+		if (casters != ALL_CASTERS && bodyStatic[body] != (casters == STATIC_CASTERS))
+		{
+			continue;
+		}
+
+		Model* model = modelList[bodyModel[body]];
+		const unsigned char* meshMask = nullptr;
+		unsigned int lod = culled ? bodyLod[body] : 0;
+
+		if (culled)
+		{
+			if (passStats)
+			{
+				passStats->draws += model->GetMeshCount();
+				passStats->triangles += model->GetTriangleCount() * views;
+			}
+
+			if (!bodyVisible[body])
+			{
+				continue;
+			}
+
+			if (cullMeshes && model->GetMeshCount() > 1)
+			{
+				model->CullMeshes(cullFrustum, bodyTransform[body], meshVisible);
+				meshMask = &meshVisible[0];
+			}
+
+			if (passStats)
+			{
+				for (size_t m = 0; m < model->GetMeshCount(); m++)
+				{
+					if (!meshMask || meshMask[m])
+					{
+						passStats->drawsVisible++;
+						passStats->trianglesVisible += model->GetMeshTriangles(m, lod) * views;
+					}
+				}
+			}
+		}
+
+		GLfloat depth = culled ? SortDepth(bodyBounds[body]) : 0.0f;
+
+		for (size_t m = 0; m < model->GetMeshCount(); m++)
+		{
+			if (meshMask && !meshMask[m])
+			{
+				continue;
+			}
+
+			Texture* texture = model->GetMeshTexture(m);
+			RenderQueue::DrawPacket packet = { model->GetMesh(m), texture, false, bodyMaterial[body],
+				&bodyTransform[body], nullptr, 1, 0, 0, lod };
+			renderQueue.Submit(packet, texture ? texture->GetTextureID() : 0, bodyMaterial[body], depth);
+		}
+	}
+
+	for (size_t b = 0; b < batchBuffer.size(); b++)
+	{
+		if (casters != ALL_CASTERS && batchStatic[b] != (casters == STATIC_CASTERS))
+		{
+			continue;
+		}
+
+		Model& model = batchIsPlanet[b] ? planets.GetSphere() : *modelList[batchModel[b]];
+
+		if (culled && passStats)
+		{
+			passStats->draws += model.GetMeshCount();
+			passStats->triangles += model.GetTriangleCount() * batchCount[b] * views;
+		}
+
+		//Culled batches draw the survivors of each LOD as a group of their own.
+		for (unsigned int lod = 0; lod < (culled ? Mesh::MAX_LODS : 1); lod++)
+		{
+			size_t slot = b * Mesh::MAX_LODS + lod;
+			GLuint buffer = culled ? batchCulledBuffer[slot] : batchBuffer[b];
+			GLuint layerBuffer = culled ? batchCulledLayerBuffer[slot] : batchLayerBuffer[b];
+			GLsizei count = culled ? batchCulledCount[slot] : batchCount[b];
+
+			if (count == 0)
+			{
+				continue;
+			}
+
+			if (culled && passStats)
+			{
+				passStats->drawsVisible += model.GetMeshCount();
+				passStats->trianglesVisible += model.GetTriangleCount(lod) * count * views;
+			}
+
+			const glm::mat4* transforms = culled ? &culledTransforms[batchCulledFirst[slot]] : &batchTransforms[batchFirst[b]];
+			const GLfloat* layers = culled ? &culledLayers[batchCulledFirst[slot]] : &batchLayers[batchFirst[b]];
+
+			//A group sorts by its nearest surviving instance.
+			GLfloat depth = culled ? 1.0f : 0.0f;
+			for (unsigned int i = 0; culled && i < batchCount[b]; i++)
+			{
+				unsigned int body = batchBodies[batchFirst[b] + i];
+				if (bodyVisible[body] && bodyLod[body] == lod)
+				{
+					depth = glm::min(depth, SortDepth(bodyBounds[body]));
+				}
+			}
+
+			for (size_t m = 0; m < model.GetMeshCount(); m++)
+			{
+				Texture* texture = batchIsPlanet[b] ? nullptr : model.GetMeshTexture(m);
+				GLuint textureID = batchIsPlanet[b] ? planets.GetTextureArray() : (texture ? texture->GetTextureID() : 0);
+				RenderQueue::DrawPacket packet = { model.GetMesh(m), texture, batchIsPlanet[b], batchMaterial[b],
+					transforms, batchIsPlanet[b] ? layers : nullptr, count, buffer, layerBuffer, lod };
+				renderQueue.Submit(packet, textureID, batchMaterial[b], depth);
+			}
+		}
+	}
+
+	renderQueue.Sort();
+
+	if (GeometryArena::IsIndirectSupported())
+	{
+		ExecuteIndirect(uniformInstanced, uniformUseTextureArray, uniformSpecularIntensity, uniformShininess, views);
+	}
+	else
+	{
+		ExecuteDirect(uniformModel, uniformInstanced, uniformUseTextureArray, uniformSpecularIntensity, uniformShininess, views);
+	}
+
+	GLState::Uniform1i(uniformInstanced, GL_FALSE);
+	GLState::Uniform1i(uniformUseTextureArray, GL_FALSE);
+}
+
+void Scene::UsePacketState(const RenderQueue::DrawPacket& packet, GLuint uniformUseTextureArray,
+	GLuint uniformSpecularIntensity, GLuint uniformShininess)
+{
+	GLState::Uniform1i(uniformUseTextureArray, packet.textureArray ? GL_TRUE : GL_FALSE);
+	materialList[packet.material].UseMaterial(uniformSpecularIntensity, uniformShininess);
+
+	if (packet.textureArray)
+	{
+		planets.UseTextureArray();
+	}
+	else if (packet.texture)
+	{
+		packet.texture->UseTexture();
+	}
+}
+
+void Scene::ExecuteDirect(GLuint uniformModel, GLuint uniformInstanced, GLuint uniformUseTextureArray,
+	GLuint uniformSpecularIntensity, GLuint uniformShininess, GLsizei views)
+{
+	//Uniforms and binds go through GLState, so consecutive packets only pay for what differs.
+	for (size_t i = 0; i < renderQueue.GetCount(); i++)
+	{
+		const RenderQueue::DrawPacket& packet = renderQueue.GetSorted(i);
+		bool instanced = packet.instanceBuffer != 0;
+
+		GLState::Uniform1i(uniformInstanced, instanced ? GL_TRUE : GL_FALSE);
+		UsePacketState(packet, uniformUseTextureArray, uniformSpecularIntensity, uniformShininess);
+
+		if (instanced)
+		{
+			packet.mesh->RenderMeshInstanced(packet.instanceBuffer, packet.instanceCount, packet.layerBuffer, views, packet.lod);
+		}
+		else
+		{
+			GLState::UniformMatrix4fv(uniformModel, glm::value_ptr(packet.transforms[0]));
+			packet.mesh->RenderMesh(views, packet.lod);
+		}
+	}
+
+	if (passStats)
+	{
+		passStats->calls += renderQueue.GetCount();
+	}
+}
+
+void Scene::ExecuteIndirect(GLuint uniformInstanced, GLuint uniformUseTextureArray,
+	GLuint uniformSpecularIntensity, GLuint uniformShininess, GLsizei views)
+{
+	size_t count = renderQueue.GetCount();
+	if (count == 0)
+	{
+		return;
+	}
+
+	//Every packet becomes an instanced command, its instances a slice of one buffer found through baseInstance.
+	indirectCommands.resize(count);
+	indirectTransforms.clear();
+	indirectLayers.clear();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const RenderQueue::DrawPacket& packet = renderQueue.GetSorted(i);
+
+		GeometryArena::IndirectCommand& command = indirectCommands[i];
+		command.count = packet.mesh->GetIndexCount(packet.lod);
+		command.instanceCount = packet.instanceCount * views;
+		command.firstIndex = packet.mesh->GetFirstIndex(packet.lod);
+		command.baseVertex = packet.mesh->GetBaseVertex();
+		command.baseInstance = indirectTransforms.size();
+
+		indirectTransforms.insert(indirectTransforms.end(), packet.transforms, packet.transforms + packet.instanceCount);
+		if (packet.layers)
+		{
+			indirectLayers.insert(indirectLayers.end(), packet.layers, packet.layers + packet.instanceCount);
+		}
+		else
+		{
+			indirectLayers.resize(indirectTransforms.size(), 0.0f);
+		}
+	}
+
+	if (indirectBuffer == 0)
+	{
+		glGenBuffers(1, &indirectBuffer);
+		glGenBuffers(1, &indirectInstanceBuffer);
+		glGenBuffers(1, &indirectLayerBuffer);
+	}
+
+	//Orphaned on every pass, like the culled batches.
+	glBindBuffer(GL_ARRAY_BUFFER, indirectInstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * indirectTransforms.size(), &indirectTransforms[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, indirectLayerBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * indirectLayers.size(), &indirectLayers[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(GeometryArena::IndirectCommand) * count, &indirectCommands[0], GL_STREAM_DRAW);
+
+	GLState::Uniform1i(uniformInstanced, GL_TRUE);
+	GeometryArena::AttachInstanceBuffers(indirectInstanceBuffer, indirectLayerBuffer);
+	GeometryArena::SetInstanceDivisor(views);
+
+	//One call per run of packets sharing texture and material, the queue already put them together.
+	size_t first = 0;
+	while (first < count)
+	{
+		const RenderQueue::DrawPacket& packet = renderQueue.GetSorted(first);
+
+		size_t last = first + 1;
+		while (last < count)
+		{
+			const RenderQueue::DrawPacket& next = renderQueue.GetSorted(last);
+			if (next.texture != packet.texture || next.textureArray != packet.textureArray || next.material != packet.material)
+			{
+				break;
+			}
+			last++;
+		}
+
+		UsePacketState(packet, uniformUseTextureArray, uniformSpecularIntensity, uniformShininess);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GeometryArena::INDEX_TYPE, (const void*)(sizeof(GeometryArena::IndirectCommand) * first),
+			(GLsizei)(last - first), 0);
+
+		if (passStats)
+		{
+			passStats->calls++;
+		}
+
+		first = last;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+GLfloat Scene::SortDepth(const glm::vec4& bounds)
+{
+	if (sortFromSphere)
+	{
+		return (glm::length(glm::vec3(bounds) - glm::vec3(sortVolume)) - bounds.w) / sortVolume.w;
+	}
+
+	//Window depth of the sphere's centre, anything behind the eye goes first.
+	glm::vec4 clip = sortMatrix * glm::vec4(glm::vec3(bounds), 1.0f);
+	return clip.w > 0.0f ? clip.z / clip.w * 0.5f + 0.5f : 0.0f;
+}
+
+void Scene::CullFrustum(const string& passName, const glm::mat4& viewProjection, bool cullSmall)
+{
+	cullFrustum.SetFromMatrix(viewProjection);
+	if (!bodyBounds.empty())
+	{
+		cullFrustum.TestSpheres(&bodyBounds[0], bodyBounds.size(), &bodyVisible[0]);
+	}
+	cullMeshes = true;
+	sortFromSphere = false;
+	sortMatrix = viewProjection;
+
+	unsigned int bodiesSmall = 0;
+	for (size_t i = 0; cullSmall && i < bodyVisible.size(); i++)
+	{
+		if (bodyVisible[i] && bodyScreenSize[i] < minScreenSize)
+		{
+			bodyVisible[i] = 0;
+			bodiesSmall++;
+		}
+	}
+
+	UploadCulled(passName, bodiesSmall);
+}
+
+void Scene::CullSphere(const string& passName, glm::vec3 center, GLfloat radius)
+{
+	for (size_t i = 0; i < bodyBounds.size(); i++)
+	{
+		bodyVisible[i] = glm::length(glm::vec3(bodyBounds[i]) - center) <= radius + bodyBounds[i].w ? 1 : 0;
+	}
+	cullMeshes = false;
+	sortFromSphere = true;
+	sortVolume = glm::vec4(center, radius);
+
+	UploadCulled(passName, 0);
+}
+
+void Scene::UploadCulled(const string& passName, unsigned int bodiesSmall)
+{
+	CullStats& stats = cullStats[passName];
+	stats = CullStats();
+	stats.bodies = bodyModel.size();
+	stats.bodiesSmall = bodiesSmall;
+	for (size_t i = 0; i < bodyVisible.size(); i++)
+	{
+		if (!bodyVisible[i]) stats.bodiesCulled++;
+		else stats.lodBodies[bodyLod[i]]++;
+	}
+	passStats = &stats;
+
+	//Every batch's survivors stay on the CPU side too, indirect draws copy them into one buffer.
+	culledTransforms.clear();
+	culledLayers.clear();
+	for (size_t slot = 0; slot < batchCulledFirst.size(); slot++)
+	{
+		size_t b = slot / Mesh::MAX_LODS;
+		unsigned int lod = slot % Mesh::MAX_LODS;
+
+		batchCulledFirst[slot] = culledTransforms.size();
+		for (unsigned int i = batchFirst[b]; i < batchFirst[b] + batchCount[b]; i++)
+		{
+			unsigned int body = batchBodies[i];
+			if (bodyVisible[body] && bodyLod[body] == lod)
+			{
+				culledTransforms.push_back(bodyTransform[body]);
+				culledLayers.push_back(batchLayers[i]);
+			}
+		}
+		batchCulledCount[slot] = culledTransforms.size() - batchCulledFirst[slot];
+	}
+
+	//Direct draws read the batches from their own buffers.
+	if (GeometryArena::IsIndirectSupported())
+	{
+		return;
+	}
+
+	for (size_t slot = 0; slot < batchCulledFirst.size(); slot++)
+	{
+		if (batchCulledCount[slot] == 0)
+		{
+			continue;
+		}
+
+		//Orphaned on every call, earlier passes keep drawing from their own copy.
+		glBindBuffer(GL_ARRAY_BUFFER, batchCulledBuffer[slot]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * batchCulledCount[slot], &culledTransforms[batchCulledFirst[slot]], GL_STREAM_DRAW);
+
+		if (batchIsPlanet[slot / Mesh::MAX_LODS])
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, batchCulledLayerBuffer[slot]);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * batchCulledCount[slot], &culledLayers[batchCulledFirst[slot]], GL_STREAM_DRAW);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Scene::PrintCullStats()
+{
+	printf("%-32s %15s %15s %19s %7s %7s  %s\n", "Culling (drawn/total)", "bodies", "draws", "triangles", "calls", "small",
+		"bodies per LOD");
+	for (auto it = cullStats.begin(); it != cullStats.end(); ++it)
+	{
+		const CullStats& stats = it->second;
+		printf("%-32s %7u/%-7u %7u/%-7u %9u/%-9u %7u %7u ", it->first.c_str(), stats.bodies - stats.bodiesCulled, stats.bodies,
+			stats.drawsVisible, stats.draws, stats.trianglesVisible, stats.triangles, stats.calls, stats.bodiesSmall);
+		for (unsigned int l = 0; l < Mesh::MAX_LODS; l++)
+		{
+			printf("%s%u", l > 0 ? "/" : " ", stats.lodBodies[l]);
+		}
+		printf("\n");
+	}
+}
+
+int Scene::FindModel(const string& name)
+{
+	for (size_t i = 0; i < modelNames.size(); i++)
+	{
+		if (modelNames[i] == name) return i;
+	}
+
+	return -1;
+}
+
+int Scene::FindMaterial(const string& name)
+{
+	for (size_t i = 0; i < materialNames.size(); i++)
+	{
+		if (materialNames[i] == name) return i;
+	}
+
+	return -1;
+}
+
+int Scene::FindBody(const string& name)
+{
+	for (size_t i = 0; i < bodyNames.size(); i++)
+	{
+		if (bodyNames[i] == name) return i;
+	}
+
+	return -1;
+}
+
+void Scene::ClearScene()
+{
+	for (size_t i = 0; i < modelList.size(); i++)
+	{
+		if (modelList[i])
+		{
+			modelList[i]->ClearModel();
+			delete modelList[i];
+			modelList[i] = nullptr;
+		}
+	}
+
+	GeometryArena::DetachInstanceBuffers();
+
+	for (size_t b = 0; b < batchBuffer.size(); b++)
+	{
+		glDeleteBuffers(1, &batchBuffer[b]);
+
+		if (batchLayerBuffer[b] != 0)
+		{
+			glDeleteBuffers(1, &batchLayerBuffer[b]);
+		}
+
+		glDeleteBuffers(Mesh::MAX_LODS, &batchCulledBuffer[b * Mesh::MAX_LODS]);
+
+		if (batchCulledLayerBuffer[b * Mesh::MAX_LODS] != 0)
+		{
+			glDeleteBuffers(Mesh::MAX_LODS, &batchCulledLayerBuffer[b * Mesh::MAX_LODS]);
+		}
+	}
+
+	if (indirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &indirectBuffer);
+		glDeleteBuffers(1, &indirectInstanceBuffer);
+		glDeleteBuffers(1, &indirectLayerBuffer);
+		indirectBuffer = indirectInstanceBuffer = indirectLayerBuffer = 0;
+	}
+
+	planets.ClearPlanets();
+
+	modelNames.clear();
+	modelList.clear();
+	modelLayer.clear();
+	materialNames.clear();
+	materialList.clear();
+
+	bodyNames.clear();
+	bodyParent.clear();
+	bodyModel.clear();
+	bodyMaterial.clear();
+	bodyPhase.clear();
+	bodyRevolution.clear();
+	bodyRadius.clear();
+	bodyHeight.clear();
+	bodySpin.clear();
+	bodyTilt.clear();
+	bodyTiltAxis.clear();
+	bodyScale.clear();
+	bodyStatic.clear();
+	bodyFrame.clear();
+	bodyTransform.clear();
+	bodyBounds.clear();
+	bodyVisible.clear();
+	bodyLod.clear();
+	bodyScreenSize.clear();
+
+	lightParent.clear();
+	lightOffset.clear();
+	lights.clear();
+
+	singleBodies.clear();
+	batchIsPlanet.clear();
+	batchStatic.clear();
+	batchModel.clear();
+	batchMaterial.clear();
+	batchFirst.clear();
+	batchCount.clear();
+	batchBuffer.clear();
+	batchLayerBuffer.clear();
+	batchBodies.clear();
+	batchLayers.clear();
+	batchTransforms.clear();
+	batchCulledBuffer.clear();
+	batchCulledLayerBuffer.clear();
+	batchCulledCount.clear();
+	batchCulledFirst.clear();
+	cullStats.clear();
+	passStats = nullptr;
+	staticUploaded = false;
+
+	staticVersion++;
+}
+
+Scene::~Scene()
+{
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+#include <glm\gtc\type_ptr.hpp>
+
+#include "Model.h"
+#include "Material.h"
+#include "PlanetRenderer.h"
+#include "GpuProfiler.h"
+#include "Frustum.h"
+#include "ClusteredLights.h"
+#include "RenderQueue.h"
+
+using namespace std;
+
+//Which bodies a pass draws. Static bodies never move, so shadow passes can cache them.
+enum CasterSet
+{
+	ALL_CASTERS,
+	STATIC_CASTERS,
+	DYNAMIC_CASTERS
+};
+
+class Scene
+{
+public:
+	Scene();
+
+	bool LoadScene(const char* fileLocation);
+
+	void Update(GLfloat angle);
+	//Picks every body's level of detail from the size of its bounding sphere on screen, seen from the camera.
+	//pixelsPerUnit is the projected size of one unit at distance one: viewport height * projection[1][1] / 2.
+	//Every pass this frame draws the levels picked here, so shadows match what the camera sees.
+	void SelectLods(glm::vec3 eyePosition, GLfloat pixelsPerUnit);
+	//Submits every mesh draw to the render queue, sorts it and runs it.
+	void RenderScene(GLuint uniformModel, GLuint uniformInstanced, GLuint uniformUseTextureArray,
+		GLuint uniformSpecularIntensity, GLuint uniformShininess, CasterSet casters = ALL_CASTERS, GLsizei views = 1,
+		bool culled = false, RenderPassID pass = PASS_MAIN);
+
+	//Build the list a culled RenderScene draws: the bodies whose bounding sphere touches
+	//a camera or light frustum, or lies within a point light's range. Frustum culling also
+	//skips the meshes of single bodies whose boxes are out of view. cullSmall also drops bodies
+	//under a pixel across at their SelectLods size, for the camera's own pass.
+	void CullFrustum(const string& passName, const glm::mat4& viewProjection, bool cullSmall = false);
+	void CullSphere(const string& passName, glm::vec3 center, GLfloat radius);
+	void PrintCullStats();
+
+	size_t GetBodyCount() { return bodyModel.size(); }
+
+	//Unshadowed lights in world space, moved along with their parent bodies by Update.
+	const vector<ClusteredLights::Light>& GetLights() { return lights; }
+
+	//Changes whenever the set of static bodies or their LODs do, so cached shadows know to rebake.
+	unsigned int GetStaticVersion() { return staticVersion; }
+
+	void ClearScene();
+
+	~Scene();
+
+private:
+	int FindModel(const string& name);
+	int FindMaterial(const string& name);
+	int FindBody(const string& name);
+
+	void CreateBatches();
+	void UploadCulled(const string& passName, unsigned int bodiesSmall);
+	GLfloat SortDepth(const glm::vec4& bounds); //0 to 1 away from the latest Cull call's viewer.
+
+	//Run the sorted queue: one call per packet, or one glMultiDrawElementsIndirect per run of
+	//packets sharing texture and material where GL 4.3 is there.
+	void ExecuteDirect(GLuint uniformModel, GLuint uniformInstanced, GLuint uniformUseTextureArray,
+		GLuint uniformSpecularIntensity, GLuint uniformShininess, GLsizei views);
+	void ExecuteIndirect(GLuint uniformInstanced, GLuint uniformUseTextureArray,
+		GLuint uniformSpecularIntensity, GLuint uniformShininess, GLsizei views);
+	void UsePacketState(const RenderQueue::DrawPacket& packet, GLuint uniformUseTextureArray,
+		GLuint uniformSpecularIntensity, GLuint uniformShininess);
+
+	//Bodies, draw calls and triangles of a pass before and after culling,
+	//counted over the culled RenderScene calls since the pass's latest Cull call.
+	struct CullStats
+	{
+		unsigned int bodies, bodiesCulled;
+		unsigned int bodiesSmall;	//Of bodiesCulled, the ones too small on screen.
+		unsigned int lodBodies[Mesh::MAX_LODS];
+		unsigned int draws, drawsVisible;
+		unsigned int triangles, trianglesVisible;
+		unsigned int calls; //Draw calls actually issued.
+	};
+
+	vector<string> modelNames;
+	vector<Model*> modelList;	//nullptr for planets drawn by the planet renderer.
+	vector<int> modelLayer;		//Planet texture array layer, -1 for ordinary models.
+
+	PlanetRenderer planets;
+
+	vector<string> materialNames;
+	vector<Material> materialList;
+
+	//Body data, one entry per celestial body (structure of arrays).
+	//Parents are always stored before their children.
+	vector<string> bodyNames;
+	vector<int> bodyParent;
+	vector<unsigned int> bodyModel;
+	vector<unsigned int> bodyMaterial;
+	vector<GLfloat> bodyPhase;
+	vector<GLfloat> bodyRevolution; //Radians per unit of angle.
+	vector<GLfloat> bodyRadius;
+	vector<GLfloat> bodyHeight;
+	vector<GLfloat> bodySpin;		//Radians per unit of angle.
+	vector<GLfloat> bodyTilt;
+	vector<glm::vec3> bodyTiltAxis;
+	vector<GLfloat> bodyScale;
+
+	vector<bool> bodyStatic;		//No revolution or spin, and a static parent.
+
+	vector<glm::mat4> bodyFrame;	 //Orbital frame children are placed in.
+	vector<glm::mat4> bodyTransform; //Final model matrix.
+	vector<glm::vec4> bodyBounds;	 //World-space bounding sphere: centre and radius.
+	vector<unsigned char> bodyVisible; //Inside the volume of the latest Cull call.
+	vector<unsigned int> bodyLod;		//Picked by SelectLods.
+	vector<GLfloat> bodyScreenSize;	//Bounding sphere diameter in pixels.
+
+	//Unshadowed lights, placed in their parent's orbital frame.
+	vector<int> lightParent;
+	vector<glm::vec3> lightOffset;
+	vector<ClusteredLights::Light> lights;
+
+	//Bodies with a model of their own are drawn one by one.
+	vector<unsigned int> singleBodies;
+
+	//Bodies sharing a model and material, and all planets sharing a material,
+	//are drawn with one instanced call per batch. Static and moving bodies never share one.
+	vector<bool> batchIsPlanet;
+	vector<bool> batchStatic;
+	vector<unsigned int> batchModel;
+	vector<unsigned int> batchMaterial;
+	vector<unsigned int> batchFirst;	//Offset into batchBodies.
+	vector<unsigned int> batchCount;
+	vector<GLuint> batchBuffer;			//Per-instance model matrices.
+	vector<GLuint> batchLayerBuffer;	//Per-instance texture array layers, 0 for ordinary models.
+	vector<unsigned int> batchBodies;
+	vector<GLfloat> batchLayers;		//Texture layer of each entry of batchBodies, 0 for ordinary models.
+	vector<glm::mat4> batchTransforms;
+	bool staticUploaded;	//Static batches' matrices never change, they are uploaded once.
+
+	//The latest Cull call's surviving instances of each batch, grouped by LOD:
+	//entry batch * Mesh::MAX_LODS + lod.
+	vector<GLuint> batchCulledBuffer;
+	vector<GLuint> batchCulledLayerBuffer;
+	vector<unsigned int> batchCulledCount;
+	vector<unsigned int> batchCulledFirst;	//Offset into culledTransforms and culledLayers.
+	vector<glm::mat4> culledTransforms;
+	vector<GLfloat> culledLayers;
+
+	Frustum cullFrustum;
+	bool cullMeshes;	//The latest Cull call was a frustum, single bodies cull per mesh.
+	vector<unsigned char> meshVisible;
+
+	//Where the latest Cull call looked from, for front-to-back sorting.
+	bool sortFromSphere;
+	glm::mat4 sortMatrix;
+	glm::vec4 sortVolume; //Centre and radius.
+
+	RenderQueue renderQueue;
+
+	//Per-pass instance data and commands of indirect draws.
+	GLuint indirectBuffer, indirectInstanceBuffer, indirectLayerBuffer;
+	vector<GeometryArena::IndirectCommand> indirectCommands;
+	vector<glm::mat4> indirectTransforms;
+	vector<GLfloat> indirectLayers;
+
+	map<string, CullStats> cullStats;
+	CullStats* passStats; //Stats of the latest Cull call's pass.
+
+	unsigned int staticVersion;
+};
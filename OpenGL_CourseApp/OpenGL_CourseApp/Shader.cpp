@@ -3,11 +3,11 @@
 Shader::Shader()
 {
 	shaderID = 0;
-	uniformModel = 0;
-	uniformProjection = 0;
-
-	pointLightCount = 0;
-	spotLightCount = 0;
+	validated = false;
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		uniformLocations[i] = -1;
+	}
 }
 
 void Shader::CreateFromString(const char* vertexCode, const char* fragmentCode)
@@ -39,6 +39,16 @@ void Shader::CreateFromFiles(const char* vertexLocation, const char* geometryLoc
 
 void Shader::Validate()
 {
+	//The state a program is drawn with does not change between frames here.
+	if (validated)
+	{
+		GLState::Record(GLState::STATE_VALIDATE, false);
+		return;
+	}
+
+	validated = true;
+	GLState::Record(GLState::STATE_VALIDATE, true);
+
 	GLint result = 0;
 	GLchar eLog[1024] = { 0 };
 
@@ -54,39 +64,24 @@ void Shader::Validate()
 
 std::string Shader::ReadFile(const char* fileLocation)
 {
-	std::string content;
-	std::ifstream fileStream(fileLocation, std::ios::in);
+	std::ifstream fileStream(fileLocation, std::ios::in | std::ios::binary);
 
 	if (!fileStream.is_open()) {
 		printf("Failed to read %s! File doesn't exist.", fileLocation);
 		return "";
 	}
 
-	std::string line = "";
-	while (!fileStream.eof())
-	{
-		std::getline(fileStream, line);
-		content.append(line + "\n");
-	}
+	//One read for the whole file, the program cache hashes the result anyway.
+	std::stringstream content;
+	content << fileStream.rdbuf();
 
 	fileStream.close();
-	return content;
+	return content.str();
 }
 
 void Shader::CompileShader(const char* vertexCode, const char* fragmentCode)
 {
-	shaderID = glCreateProgram();
-
-	if (!shaderID)
-	{
-		printf("Error creating shader program!\n");
-		return;
-	}
-
-	AddShader(shaderID, vertexCode, GL_VERTEX_SHADER);
-	AddShader(shaderID, fragmentCode, GL_FRAGMENT_SHADER);
-
-	CompileProgram();
+	CompileShader(vertexCode, nullptr, fragmentCode);
 }
 
 void Shader::CompileShader(const char* vertexCode, const char* geometryCode, const char* fragmentCode)
@@ -99,260 +94,193 @@ void Shader::CompileShader(const char* vertexCode, const char* geometryCode, con
 		return;
 	}
 
+	//A program linked on an earlier run with the same sources and driver skips compilation.
+	uint64_t cacheKey = ProgramCache::MakeKey(vertexCode, geometryCode, fragmentCode);
+	if (ProgramCache::Load(shaderID, cacheKey))
+	{
+		ReflectProgram();
+		return;
+	}
+
 	AddShader(shaderID, vertexCode, GL_VERTEX_SHADER);
-	AddShader(shaderID, geometryCode, GL_GEOMETRY_SHADER);
+	if (geometryCode)
+	{
+		AddShader(shaderID, geometryCode, GL_GEOMETRY_SHADER);
+	}
 	AddShader(shaderID, fragmentCode, GL_FRAGMENT_SHADER);
 
-	CompileProgram();
+	if (CompileProgram())
+	{
+		ProgramCache::Save(shaderID, cacheKey);
+	}
 }
 
-
-void Shader::CompileProgram()
+bool Shader::CompileProgram()
 {
 	GLint result = 0;
 	GLchar eLog[1024] = { 0 };
 
+	if (ProgramCache::IsSupported())
+	{
+		glProgramParameteri(shaderID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	glLinkProgram(shaderID);
 	glGetProgramiv(shaderID, GL_LINK_STATUS, &result);
 	if (!result)
 	{
 		glGetProgramInfoLog(shaderID, sizeof(eLog), NULL, eLog);
 		printf("Error linking program: '%s'\n", eLog);
-		return;
-	}
-
-	uniformProjection = glGetUniformLocation(shaderID, "projection");
-	uniformModel = glGetUniformLocation(shaderID, "model");
-	uniformView = glGetUniformLocation(shaderID, "view");
-	uniformDirectionalLight.uniformColour = glGetUniformLocation(shaderID, "directionalLight.base.colour");
-	uniformDirectionalLight.uniformAmbientIntensity = glGetUniformLocation(shaderID, "directionalLight.base.ambientIntensity");
-	uniformDirectionalLight.uniformDirection = glGetUniformLocation(shaderID, "directionalLight.direction");
-	uniformDirectionalLight.uniformDiffuseIntensity = glGetUniformLocation(shaderID, "directionalLight.base.diffuseIntensity");
-	uniformSpecularIntensity = glGetUniformLocation(shaderID, "material.specularIntensity");
-	uniformShininess = glGetUniformLocation(shaderID, "material.shininess");
-	uniformEyePosition = glGetUniformLocation(shaderID, "eyePosition");
-
-	uniformPointLightCount = glGetUniformLocation(shaderID, "pointLightCount");
-
-	for (size_t i = 0; i < MAX_POINT_LIGHTS; i++)
-	{
-		char locBuff[100] = { '\0' };
-
-		snprintf(locBuff, sizeof(locBuff), "pointLights[%d].base.colour", i);
-		uniformPointLight[i].uniformColour = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "pointLights[%d].base.ambientIntensity", i);
-		uniformPointLight[i].uniformAmbientIntensity = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "pointLights[%d].base.diffuseIntensity", i);
-		uniformPointLight[i].uniformDiffuseIntensity = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "pointLights[%d].position", i);
-		uniformPointLight[i].uniformPosition = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "pointLights[%d].constant", i);
-		uniformPointLight[i].uniformConstant = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "pointLights[%d].linear", i);
-		uniformPointLight[i].uniformLinear = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "pointLights[%d].exponent", i);
-		uniformPointLight[i].uniformExponent = glGetUniformLocation(shaderID, locBuff);
+		return false;
 	}
 
-	uniformSpotLightCount = glGetUniformLocation(shaderID, "spotLightCount");
-
-	for (size_t i = 0; i < MAX_SPOT_LIGHTS; i++)
-	{
-		char locBuff[100] = { '\0' };
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].base.base.colour", i);
-		uniformSpotLight[i].uniformColour = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].base.base.ambientIntensity", i);
-		uniformSpotLight[i].uniformAmbientIntensity = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].base.base.diffuseIntensity", i);
-		uniformSpotLight[i].uniformDiffuseIntensity = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].base.position", i);
-		uniformSpotLight[i].uniformPosition = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].base.constant", i);
-		uniformSpotLight[i].uniformConstant = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].base.linear", i);
-		uniformSpotLight[i].uniformLinear = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].base.exponent", i);
-		uniformSpotLight[i].uniformExponent = glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].direction", i);
-		uniformSpotLight[i].uniformDirection = glGetUniformLocation(shaderID, locBuff);
+	ReflectProgram();
+	return true;
+}
 
-		snprintf(locBuff, sizeof(locBuff), "spotLights[%d].edge", i);
-		uniformSpotLight[i].uniformEdge = glGetUniformLocation(shaderID, locBuff);
-	}
+void Shader::ReflectProgram()
+{
+	UniformTable::Reflect(shaderID, uniformLocations);
 
-	for (size_t i = 0; i < MAX_SPOT_LIGHTS + MAX_POINT_LIGHTS; i++)
+	//Shared per-frame data, programs without the blocks just skip them.
+	GLuint frameBlock = glGetUniformBlockIndex(shaderID, "Frame");
+	if (frameBlock != GL_INVALID_INDEX)
 	{
-		char locBuff[100] = { '\0' };
-
-		snprintf(locBuff, sizeof(locBuff), "omniShadowMaps[%d].shadowMap", i);
-		uniformOmniShadowMap[i].shadowMap= glGetUniformLocation(shaderID, locBuff);
-
-		snprintf(locBuff, sizeof(locBuff), "omniShadowMaps[%d].farPlane", i);
-		uniformOmniShadowMap[i].farPlane = glGetUniformLocation(shaderID, locBuff);
+		glUniformBlockBinding(shaderID, frameBlock, FRAME_BLOCK_BINDING);
 	}
 
-	uniformDirectionalLightTransform = glGetUniformLocation(shaderID, "directionalLightTransform");
-	uniformTexture = glGetUniformLocation(shaderID, "theTexture");
-	uniformDirectionalShadowMap = glGetUniformLocation(shaderID, "directionalShadowMap");
-
-	uniformOmnLightPos = glGetUniformLocation(shaderID, "lightPos");
-	uniformFarPlane = glGetUniformLocation(shaderID, "farPlane");
-
-	for (size_t i = 0; i < 6; i++)
+	GLuint lightsBlock = glGetUniformBlockIndex(shaderID, "Lights");
+	if (lightsBlock != GL_INVALID_INDEX)
 	{
-		char locBuff[100] = { '\0' };
-
-		snprintf(locBuff, sizeof(locBuff), "lightMatrices[%d]", i);
-		uniformLightMatrices[i] = glGetUniformLocation(shaderID, locBuff);
+		glUniformBlockBinding(shaderID, lightsBlock, LIGHTS_BLOCK_BINDING);
 	}
 }
 
 GLuint Shader::GetProjectionLocation()
 {
-	return uniformProjection;
+	return uniformLocations[UNIFORM_PROJECTION];
 }
 GLuint Shader::GetModelLocation()
 {
-	return uniformModel;
+	return uniformLocations[UNIFORM_MODEL];
 }
 GLuint Shader::GetViewLocation()
 {
-	return uniformView;
-}
-GLuint Shader::GetAmbientColourLocation()
-{
-	return uniformDirectionalLight.uniformColour;
-}
-GLuint Shader::GetAmbientIntensityLocation()
-{
-	return uniformDirectionalLight.uniformAmbientIntensity;
-}
-GLuint Shader::GetDiffuseIntensityLocation()
-{
-	return uniformDirectionalLight.uniformDiffuseIntensity;
-}
-GLuint Shader::GetDirectionLocation()
-{
-	return uniformDirectionalLight.uniformDirection;
+	return uniformLocations[UNIFORM_VIEW];
 }
 GLuint Shader::GetSpecularIntensityLocation()
 {
-	return uniformSpecularIntensity;
+	return uniformLocations[UNIFORM_SPECULAR_INTENSITY];
 }
 GLuint Shader::GetShininessLocation()
 {
-	return uniformShininess;
-}
-GLuint Shader::GetEyePositionLocation()
-{
-	return uniformEyePosition;
+	return uniformLocations[UNIFORM_SHININESS];
 }
 GLuint Shader::GetOmniLightPosLocation()
 {
-	return uniformOmnLightPos;
+	return uniformLocations[UNIFORM_OMNI_LIGHT_POS];
 }
 GLuint Shader::GetFarPlaneLocation()
 {
-	return uniformFarPlane;
+	return uniformLocations[UNIFORM_FAR_PLANE];
 }
-
-void Shader::SetDirectionalLight(DirectionalLight * dLight)
+GLuint Shader::GetInstancedLocation()
+{
+	return uniformLocations[UNIFORM_INSTANCED];
+}
+GLuint Shader::GetUseTextureArrayLocation()
 {
-	dLight->UseLight(uniformDirectionalLight.uniformAmbientIntensity, uniformDirectionalLight.uniformColour,
-		uniformDirectionalLight.uniformDiffuseIntensity, uniformDirectionalLight.uniformDirection);
+	return uniformLocations[UNIFORM_USE_TEXTURE_ARRAY];
 }
 
 void Shader::SetPointLights(PointLight * pLight, unsigned int lightCount, unsigned int textureUnit, unsigned int offset)
 {
-	if (lightCount > MAX_POINT_LIGHTS) lightCount = MAX_POINT_LIGHTS;
+	CPU_ZONE("Shader::SetPointLights");
 
-	glUniform1i(uniformPointLightCount, lightCount);
+	if (lightCount > MAX_POINT_LIGHTS) lightCount = MAX_POINT_LIGHTS;
 
 	for (size_t i = 0; i < lightCount; i++)
 	{
-		pLight[i].UseLight(uniformPointLight[i].uniformAmbientIntensity, uniformPointLight[i].uniformColour,
-			uniformPointLight[i].uniformDiffuseIntensity, uniformPointLight[i].uniformPosition,
-			uniformPointLight[i].uniformConstant, uniformPointLight[i].uniformLinear, uniformPointLight[i].uniformExponent);
-
-
 		pLight[i].GetShadowMap()->Read(GL_TEXTURE0 + textureUnit + i);
-		glUniform1i(uniformOmniShadowMap[i + offset].shadowMap, textureUnit + i);
-		glUniform1f(uniformOmniShadowMap[i + offset].farPlane, pLight[i].GetFarPlane());
+		GLState::Uniform1i(uniformLocations[UNIFORM_OMNI_SHADOW_MAPS + offset + i], textureUnit + i);
+		GLState::Uniform1f(uniformLocations[UNIFORM_OMNI_FAR_PLANES + offset + i], pLight[i].GetFarPlane());
 	}
 }
 
 void Shader::SetSpotLights(SpotLight * sLight, unsigned int lightCount, unsigned int textureUnit, unsigned int offset)
 {
-	if (lightCount > MAX_SPOT_LIGHTS) lightCount = MAX_SPOT_LIGHTS;
+	CPU_ZONE("Shader::SetSpotLights");
 
-	glUniform1i(uniformSpotLightCount, lightCount);
+	if (lightCount > MAX_SPOT_LIGHTS) lightCount = MAX_SPOT_LIGHTS;
 
 	for (size_t i = 0; i < lightCount; i++)
 	{
-		sLight[i].UseLight(uniformSpotLight[i].uniformAmbientIntensity, uniformSpotLight[i].uniformColour,
-			uniformSpotLight[i].uniformDiffuseIntensity, uniformSpotLight[i].uniformPosition, uniformSpotLight[i].uniformDirection,
-			uniformSpotLight[i].uniformConstant, uniformSpotLight[i].uniformLinear, uniformSpotLight[i].uniformExponent,
-			uniformSpotLight[i].uniformEdge);
-
-
 		sLight[i].GetShadowMap()->Read(GL_TEXTURE0 + textureUnit + i);
-		glUniform1i(uniformOmniShadowMap[i + offset].shadowMap, textureUnit + i);
-		glUniform1f(uniformOmniShadowMap[i + offset].farPlane, sLight[i].GetFarPlane());
+		GLState::Uniform1i(uniformLocations[UNIFORM_OMNI_SHADOW_MAPS + offset + i], textureUnit + i);
+		GLState::Uniform1f(uniformLocations[UNIFORM_OMNI_FAR_PLANES + offset + i], sLight[i].GetFarPlane());
 	}
 }
 
+void Shader::SetClusteredLights(ClusteredLights* clusters, unsigned int textureUnit)
+{
+	clusters->UseClusters(uniformLocations[UNIFORM_CLUSTER_LIGHTS], uniformLocations[UNIFORM_CLUSTER_GRID],
+		uniformLocations[UNIFORM_CLUSTER_INDICES], uniformLocations[UNIFORM_CLUSTER_TILE_SCALE],
+		uniformLocations[UNIFORM_CLUSTER_SLICES], textureUnit);
+}
+
 void Shader::SetTexture(GLuint textureUnit)
 {
-	glUniform1i(uniformTexture, textureUnit);
+	GLState::Uniform1i(uniformLocations[UNIFORM_TEXTURE], textureUnit);
+}
+
+void Shader::SetTextureArray(GLuint textureUnit)
+{
+	GLState::Uniform1i(uniformLocations[UNIFORM_TEXTURE_ARRAY], textureUnit);
 }
 
 void Shader::SetDirectionalShadowMap(GLuint textureUnit)
 {
-	glUniform1i(uniformDirectionalShadowMap, textureUnit);
+	GLState::Uniform1i(uniformLocations[UNIFORM_DIRECTIONAL_SHADOW_MAP], textureUnit);
 }
 
 void Shader::SetDirectionalLightTransform(glm::mat4 * lTransform)
 {
-	glUniformMatrix4fv(uniformDirectionalLightTransform, 1, GL_FALSE, glm::value_ptr(*lTransform));
+	GLState::UniformMatrix4fv(uniformLocations[UNIFORM_DIRECTIONAL_LIGHT_TRANSFORM], glm::value_ptr(*lTransform));
 }
 
 void Shader::SetLightMatrices(std::vector<glm::mat4> lightMatrices)
 {
 	for (size_t i = 0; i < 6; i++)
 	{
-		glUniformMatrix4fv(uniformLightMatrices[i], 1, GL_FALSE, glm::value_ptr(lightMatrices[i]));
+		GLState::UniformMatrix4fv(uniformLocations[UNIFORM_LIGHT_MATRICES + i], glm::value_ptr(lightMatrices[i]));
 	}
 }
 
+void Shader::SetFace(GLuint face)
+{
+	GLState::Uniform1i(uniformLocations[UNIFORM_FACE], face);
+}
+
 void Shader::UseShader()
 {
-	glUseProgram(shaderID);
+	GLState::UseProgram(shaderID);
 }
 
 void Shader::ClearShader()
 {
 	if (shaderID != 0)
 	{
+		GLState::ForgetProgram(shaderID);
 		glDeleteProgram(shaderID);
 		shaderID = 0;
 	}
 
-	uniformModel = 0;
-	uniformProjection = 0;
+	validated = false;
+
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		uniformLocations[i] = -1;
+	}
 }
 
 
@@ -3,6 +3,7 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include <GL\glew.h>
 #include <glm\glm.hpp>
@@ -11,8 +12,13 @@
 #include "DirectionalLight.h"
 #include "PointLight.h"
 #include "SpotLight.h"
+#include "ClusteredLights.h"
+#include "UniformTable.h"
+#include "ProgramCache.h"
 
 #include "CommonValues.h"
+#include "GLState.h"
+#include "CpuProfiler.h"
 
 
 using namespace std;
@@ -26,30 +32,30 @@ public:
 	void CreateFromFiles(const char* vertexLocation, const char* fragmentLocation);
 	void CreateFromFiles(const char* vertexLocation, const char* geometryLocation, const char* fragmentLocation);
 
-	void Validate();
+	void Validate(); //Once per program, later calls are counted as elided.
 
 	string ReadFile(const char* fileLocation);
 
 	GLuint GetModelLocation();
 	GLuint GetProjectionLocation();
 	GLuint GetViewLocation();
-	GLuint GetAmbientIntensityLocation();
-	GLuint GetAmbientColourLocation();
-	GLuint GetDiffuseIntensityLocation();
-	GLuint GetDirectionLocation();
 	GLuint GetSpecularIntensityLocation();
 	GLuint GetShininessLocation();
-	GLuint GetEyePositionLocation();
 	GLuint GetOmniLightPosLocation();
 	GLuint GetFarPlaneLocation();
+	GLuint GetInstancedLocation();
+	GLuint GetUseTextureArrayLocation();
 
-	void SetDirectionalLight(DirectionalLight* dLight);
+	//Light data comes from the Lights uniform block, these only bind the omni shadow maps.
 	void SetPointLights(PointLight *pLight, unsigned int lightCount, unsigned int textureUnit,unsigned int offset);
 	void SetSpotLights(SpotLight *sLight, unsigned int lightCount, unsigned int textureUnit, unsigned int offset);
+	void SetClusteredLights(ClusteredLights* clusters, unsigned int textureUnit);
 	void SetTexture(GLuint textureUnit);
+	void SetTextureArray(GLuint textureUnit);
 	void SetDirectionalShadowMap(GLuint textureUnit);
 	void SetDirectionalLightTransform(glm::mat4 *lTransform);
 	void SetLightMatrices(vector<glm::mat4> lightMatrices);
+	void SetFace(GLuint face);
 
 	void UseShader();
 	void ClearShader();
@@ -57,66 +63,16 @@ public:
 	~Shader();
 
 private:
-	int pointLightCount;
-	int spotLightCount;
+	GLuint shaderID;
+	bool validated;
 
-	GLuint shaderID, uniformProjection, uniformModel, uniformView,
-		uniformEyePosition, uniformSpecularIntensity, uniformShininess, uniformTexture,
-		uniformDirectionalLightTransform, uniformDirectionalShadowMap, uniformOmnLightPos, uniformFarPlane;
-
-	GLuint uniformLightMatrices[6];
-
-	struct
-	{
-		GLuint uniformColour;
-		GLuint uniformAmbientIntensity;
-		GLuint uniformDiffuseIntensity;
-
-		GLuint uniformDirection;
-	} uniformDirectionalLight;
-
-	GLuint uniformPointLightCount;
-
-	struct
-	{
-		GLuint uniformColour;
-		GLuint uniformAmbientIntensity;
-		GLuint uniformDiffuseIntensity;
-
-		GLuint uniformPosition;
-		GLuint uniformConstant;
-		GLuint uniformLinear;
-		GLuint uniformExponent;
-
-	} uniformPointLight[MAX_POINT_LIGHTS];
-
-	GLuint uniformSpotLightCount;
-
-	struct
-	{
-		GLuint uniformColour;
-		GLuint uniformAmbientIntensity;
-		GLuint uniformDiffuseIntensity;
-
-		GLuint uniformPosition;
-		GLuint uniformConstant;
-		GLuint uniformLinear;
-		GLuint uniformExponent;
-
-		GLuint uniformDirection;
-		GLuint uniformEdge;
-	} uniformSpotLight[MAX_SPOT_LIGHTS];
-
-	struct 
-	{
-		GLuint shadowMap;
-		GLuint farPlane;
-	} uniformOmniShadowMap[MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS];
+	GLint uniformLocations[UNIFORM_COUNT]; //Filled by UniformTable::Reflect at link time.
 
 	void CompileShader(const char* vertexCode, const char* fragmentCode);
 	void CompileShader(const char* vertexCode, const char* geometryCode, const char* fragmentCode);
 	void AddShader(GLuint theProgram, const char* shaderCode, GLenum shaderType);
 
-	void CompileProgram();
+	bool CompileProgram();
+	void ReflectProgram(); //Everything that follows a successful link, compiled or loaded.
 };
 
@@ -13,7 +13,7 @@ bool ShadowMap::Init(GLuint width, GLuint height)
 	glGenFramebuffers(1, &FBO);
 
 	glGenTextures(1, &shadowMap);
-	glBindTexture(GL_TEXTURE_2D, shadowMap);
+	GLState::BindTexture(GL_TEXTURE_2D, shadowMap);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, shadowWidth, shadowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
@@ -48,8 +48,7 @@ void ShadowMap::Write()
 
 void ShadowMap::Read(GLenum textureUnit)
 {
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, shadowMap);
+	GLState::BindTexture(textureUnit, GL_TEXTURE_2D, shadowMap);
 }
 
 ShadowMap::~ShadowMap()
@@ -61,6 +60,7 @@ ShadowMap::~ShadowMap()
 
 	if (shadowMap)
 	{
+		GLState::ForgetTexture(shadowMap);
 		glDeleteTextures(1, &shadowMap);
 	}
 }
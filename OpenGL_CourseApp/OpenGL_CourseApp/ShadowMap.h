@@ -4,6 +4,8 @@
 #include <GL\glew.h>
 #include <iostream>
 
+#include "GLState.h"
+
 using namespace std;
 
 class ShadowMap
@@ -2,6 +2,11 @@
 
 Skybox::Skybox()
 {
+	skyMesh = nullptr;
+	skyShader = nullptr;
+	textureID = 0;
+	uniformProjection = 0;
+	uniformView = 0;
 }
 
 Skybox::Skybox(vector<string> faceLocations)
@@ -14,33 +19,7 @@ Skybox::Skybox(vector<string> faceLocations)
 	uniformView = skyShader->GetViewLocation();
 
 	//Texture setup.
-	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-	int width, height, bitDepth;
-
-
-	for (size_t i = 0; i < 6; i++)
-	{
-		unsigned char *texData = stbi_load(faceLocations[i].c_str(), &width, &height, &bitDepth, 0);
-
-		if (!texData)
-		{
-			cout << "Failed to find:\t" << faceLocations[i].c_str() << endl;
-			return;
-		}
-		
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, texData);
-		stbi_image_free(texData);
-	}
-
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-	//Texture Parameters filter:
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	textureID = TextureCache::AcquireCubeMap(faceLocations);
 
 	// Mesh Setup Code (to save you havin to type out the vertices of a cube!)
 	unsigned int skyboxIndices[] = {
@@ -89,11 +68,10 @@ void Skybox::DrawSkybox(glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
 
 	skyShader->UseShader();
 
-	glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-	glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+	GLState::UniformMatrix4fv(uniformProjection, glm::value_ptr(projectionMatrix));
+	GLState::UniformMatrix4fv(uniformView, glm::value_ptr(viewMatrix));
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP,textureID);
+	GLState::BindTexture(GL_TEXTURE0, GL_TEXTURE_CUBE_MAP, textureID);
 
 	skyShader->Validate();
 
@@ -105,4 +83,13 @@ void Skybox::DrawSkybox(glm::mat4 viewMatrix, glm::mat4 projectionMatrix)
 
 Skybox::~Skybox()
 {
+	//Owns its mesh and shader, the cube map is shared through the cache.
+	if (textureID != 0)
+	{
+		TextureCache::ReleaseCubeMap(textureID);
+		textureID = 0;
+	}
+
+	delete skyMesh;
+	delete skyShader;
 }
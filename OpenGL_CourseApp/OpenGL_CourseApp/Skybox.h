@@ -14,6 +14,7 @@
 
 #include "Shader.h"
 #include "Mesh.h"
+#include "TextureCache.h"
 
 using namespace std;
 #pragma endregion
@@ -27,6 +28,7 @@ public:
 
 	void DrawSkybox(glm::mat4 viewMatrix,glm::mat4 projectionMatrix);
 
+	//Releases the cube map, so it has to go before the GL context does. Not copyable.
 	~Skybox();
 
 private:
@@ -25,30 +25,18 @@ SpotLight::SpotLight(GLfloat shadowWidth, GLfloat shadowHeight,
 	procEdge = cosf(glm::radians(edge));
 }
 
-void SpotLight::UseLight(GLuint ambientIntensityLocation, GLuint ambientColourLocation,
-	GLuint diffuseIntensityLocation, GLuint positionLocation, GLuint directionLocation,
-	GLuint constantLocation, GLuint linearLocation, GLuint exponentLocation,
-	GLuint edgeLocation)
+void SpotLight::WriteBlock(SpotLightBlock& block)
 {
-	glUniform3f(ambientColourLocation, colour.x, colour.y, colour.z);
+	PointLight::WriteBlock(block.base);
 
-	if (isOn)
+	if (!isOn)
 	{
-		glUniform1f(ambientIntensityLocation, ambientIntensity);
-		glUniform1f(diffuseIntensityLocation, diffuseIntensity);
+		block.base.base.ambientIntensity = 0.0f;
+		block.base.base.diffuseIntensity = 0.0f;
 	}
-	else {
-		glUniform1f(ambientIntensityLocation, 0.0f);
-		glUniform1f(diffuseIntensityLocation, 0.0f);
-	}
-
-	glUniform3f(positionLocation, position.x, position.y, position.z);
-	glUniform1f(constantLocation, constant);
-	glUniform1f(linearLocation, linear);
-	glUniform1f(exponentLocation, exponent);
 
-	glUniform3f(directionLocation, direction.x, direction.y, direction.z);
-	glUniform1f(edgeLocation, procEdge);
+	block.direction = direction;
+	block.edge = procEdge;
 }
 
 void SpotLight::SetFlash(glm::vec3 pos, glm::vec3 dir)
@@ -15,9 +15,7 @@ public:
 		GLfloat con, GLfloat lin, GLfloat exp,
 		GLfloat edge);
 
-	void UseLight(GLuint ambientIntensityLocation, GLuint ambientColourLocation,
-		GLuint diffuseIntensityLocation, GLuint positionLocation, GLuint directionLocation,
-		GLuint constantLocation, GLuint linearLocation, GLuint exponentLocation,GLuint edgeLocation);
+	void WriteBlock(SpotLightBlock& block);
 	
 	void SetFlash(glm::vec3 pos, glm::vec3 dir);
 
@@ -19,7 +19,12 @@ Texture::Texture(const char* fileLoc)
 
 bool Texture::LoadTextureA()
 {
-	unsigned char *texData = stbi_load(fileLocation, &width, &height, &bitDepth, 0);
+	if (LoadTextureKtx())
+	{
+		return true;
+	}
+
+	unsigned char *texData = stbi_load(fileLocation.c_str(), &width, &height, &bitDepth, 0);
 
 	if (!texData)
 	{
@@ -29,21 +34,21 @@ bool Texture::LoadTextureA()
 
 	//creating texture objects 
 	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	GLState::BindTexture(GL_TEXTURE_2D, textureID);
 
 	//Wrapping
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
 	//Texture Parameters filter:
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	//creating texture objects 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texData);
 	glGenerateMipmap(GL_TEXTURE_2D);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
 
 	stbi_image_free(texData);
 
@@ -52,7 +57,12 @@ bool Texture::LoadTextureA()
 
 bool Texture::LoadTexture()
 {
-	unsigned char *texData = stbi_load(fileLocation, &width, &height, &bitDepth, 0);
+	if (LoadTextureKtx())
+	{
+		return true;
+	}
+
+	unsigned char *texData = stbi_load(fileLocation.c_str(), &width, &height, &bitDepth, 0);
 
 	if (!texData)
 	{
@@ -62,35 +72,104 @@ bool Texture::LoadTexture()
 
 	//creating texture objects 
 	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	GLState::BindTexture(GL_TEXTURE_2D, textureID);
 
 	//Wrapping
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
 	//Texture Parameters filter:
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	//creating texture objects 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, texData);
 	glGenerateMipmap(GL_TEXTURE_2D);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
 
 	stbi_image_free(texData);
 
 	return true;
 }
 
+bool Texture::LoadTextureAsync(bool hasAlpha)
+{
+	//Compressed files need no decoding, upload them straight away.
+	if (LoadTextureKtx())
+	{
+		return true;
+	}
+
+	//Only the header is read here, so missing files still fail straight away.
+	if (!stbi_info(fileLocation.c_str(), &width, &height, &bitDepth))
+	{
+		cout << "Failed to find:\t" << fileLocation << endl;
+		return false;
+	}
+
+	glGenTextures(1, &textureID);
+	GLState::BindTexture(GL_TEXTURE_2D, textureID);
+
+	//Wrapping
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	//Texture Parameters filter:
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	//1x1 white placeholder until the decoded image is committed.
+	const unsigned char placeholder[4] = { 255, 255, 255, 255 };
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+
+	TextureLoader::LoadAsync(vector<string>(1, fileLocation), hasAlpha ? 4 : 3, textureID, GL_TEXTURE_2D);
+
+	return true;
+}
+
+bool Texture::LoadTextureKtx()
+{
+	KtxFile ktx;
+	if (!KtxFile::IsSupported() || !ktx.LoadCooked(fileLocation) || ktx.GetFaceCount() != 1)
+	{
+		return false;
+	}
+
+	width = ktx.GetWidth();
+	height = ktx.GetHeight();
+	bitDepth = ktx.GetInternalFormat() == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 3 : 4;
+
+	glGenTextures(1, &textureID);
+	GLState::BindTexture(GL_TEXTURE_2D, textureID);
+
+	//Wrapping
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	//Texture Parameters filter:
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ktx.GetLevelCount() - 1);
+
+	ktx.UploadImage(GL_TEXTURE_2D);
+
+	GLState::BindTexture(GL_TEXTURE_2D, 0);
+
+	return true;
+}
+
 void Texture::UseTexture()
 {
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	GLState::BindTexture(GL_TEXTURE1, GL_TEXTURE_2D, textureID);
 }
 
 void Texture::ClearTexture()
 {
+	TextureLoader::Cancel(textureID);
+	GLState::ForgetTexture(textureID);
 	glDeleteTextures(1, &textureID);
 	textureID = 0;
 	width = 0;
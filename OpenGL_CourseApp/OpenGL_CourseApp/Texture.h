@@ -1,8 +1,12 @@
 #pragma once
 #include <iostream>
+#include <string>
 #include <GL\glew.h>
 
 #include "CommonValues.h"
+#include "GLState.h"
+#include "TextureLoader.h"
+#include "KtxFile.h"
 
 using namespace std;
 
@@ -14,16 +18,22 @@ public:
 
 	bool LoadTexture();
 	bool LoadTextureA(); //Load texture with Alpha.
+	bool LoadTextureAsync(bool hasAlpha); //Placeholder now, decoded on the TextureLoader pool.
 	
 	void UseTexture();
 	void ClearTexture();
 
+	const char* GetFileLocation() { return fileLocation.c_str(); }
+	GLuint GetTextureID() { return textureID; }
+
 	~Texture();
 
 private:
+	bool LoadTextureKtx(); //Cooked copy with baked mips, if there is one.
+
 	GLuint textureID;
 	int width, height, bitDepth;
 
-	const char* fileLocation;
+	string fileLocation;
 };
 
@@ -0,0 +1,174 @@
+#include "TextureCache.h"
+
+unordered_map<string, TextureCache::TextureEntry> TextureCache::textures;
+unordered_map<string, TextureCache::CubeMapEntry> TextureCache::cubeMaps;
+
+unsigned int TextureCache::hitCount = 0;
+unsigned int TextureCache::missCount = 0;
+
+Texture* TextureCache::AcquireTexture(const string& fileLocation, bool hasAlpha)
+{
+	//RGB and RGBA uploads of the same file are different GL textures.
+	string key = fileLocation + (hasAlpha ? "|rgba" : "|rgb");
+
+	auto found = textures.find(key);
+	if (found != textures.end())
+	{
+		hitCount++;
+		found->second.refCount++;
+		return found->second.texture;
+	}
+
+	missCount++;
+
+	Texture* texture = new Texture(fileLocation.c_str());
+
+	if (!texture->LoadTextureAsync(hasAlpha))
+	{
+		delete texture;
+		texture = nullptr;
+	}
+
+	TextureEntry entry = { texture, 1 };
+	textures[key] = entry;
+
+	return texture;
+}
+
+void TextureCache::ReleaseTexture(Texture* texture)
+{
+	if (!texture)
+	{
+		return;
+	}
+
+	for (auto it = textures.begin(); it != textures.end(); ++it)
+	{
+		if (it->second.texture == texture)
+		{
+			if (--it->second.refCount == 0)
+			{
+				delete texture;
+				textures.erase(it);
+			}
+			return;
+		}
+	}
+}
+
+GLuint TextureCache::AcquireCubeMap(const vector<string>& faceLocations)
+{
+	string key;
+	for (size_t i = 0; i < faceLocations.size(); i++)
+	{
+		key += faceLocations[i] + "|";
+	}
+
+	auto found = cubeMaps.find(key);
+	if (found != cubeMaps.end())
+	{
+		hitCount++;
+		found->second.refCount++;
+		return found->second.textureID;
+	}
+
+	missCount++;
+
+	CubeMapEntry entry = { LoadCubeMap(faceLocations), 1 };
+	cubeMaps[key] = entry;
+
+	return entry.textureID;
+}
+
+void TextureCache::ReleaseCubeMap(GLuint textureID)
+{
+	for (auto it = cubeMaps.begin(); it != cubeMaps.end(); ++it)
+	{
+		if (it->second.textureID == textureID)
+		{
+			if (--it->second.refCount == 0)
+			{
+				TextureLoader::Cancel(textureID);
+				GLState::ForgetTexture(textureID);
+				glDeleteTextures(1, &textureID);
+				cubeMaps.erase(it);
+			}
+			return;
+		}
+	}
+}
+
+GLuint TextureCache::LoadCubeMap(const vector<string>& faceLocations)
+{
+	GLuint textureID = LoadCubeMapKtx(faceLocations);
+	if (textureID != 0)
+	{
+		return textureID;
+	}
+
+	glGenTextures(1, &textureID);
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+	//1x1 black faces until the decoded images are committed.
+	const unsigned char placeholder[3] = { 0, 0, 0 };
+	for (size_t i = 0; i < 6; i++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder);
+	}
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	//Texture Parameters filter:
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	TextureLoader::LoadAsync(faceLocations, 3, textureID, GL_TEXTURE_CUBE_MAP);
+
+	return textureID;
+}
+
+GLuint TextureCache::LoadCubeMapKtx(const vector<string>& faceLocations)
+{
+	if (!KtxFile::IsSupported() || faceLocations.size() != 6)
+	{
+		return 0;
+	}
+
+	//All six faces must be cooked the same way, otherwise fall back to the source images.
+	vector<KtxFile> faces(6);
+	for (size_t i = 0; i < 6; i++)
+	{
+		if (!faces[i].LoadCooked(faceLocations[i]) || faces[i].GetFaceCount() != 1
+			|| !faces[i].IsCompatible(faces[0]) || faces[i].GetWidth() != faces[i].GetHeight())
+		{
+			return 0;
+		}
+	}
+
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+	for (size_t i = 0; i < 6; i++)
+	{
+		faces[i].UploadImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
+	}
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	//Texture Parameters filter:
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, faces[0].GetLevelCount() - 1);
+
+	GLState::BindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	return textureID;
+}
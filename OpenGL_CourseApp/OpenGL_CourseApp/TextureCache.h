@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <GL\glew.h>
+
+#include "CommonValues.h"
+#include "Texture.h"
+
+using namespace std;
+
+//Process-wide, reference-counted textures keyed by file path, so every image
+//file is decoded and uploaded once no matter how many users it has.
+class TextureCache
+{
+public:
+	static Texture* AcquireTexture(const string& fileLocation, bool hasAlpha);
+	static void ReleaseTexture(Texture* texture);
+
+	static GLuint AcquireCubeMap(const vector<string>& faceLocations);
+	static void ReleaseCubeMap(GLuint textureID);
+
+	static unsigned int GetHitCount() { return hitCount; }
+	static unsigned int GetMissCount() { return missCount; }
+
+private:
+	struct TextureEntry
+	{
+		Texture* texture; //nullptr when the file failed to load.
+		unsigned int refCount;
+	};
+
+	struct CubeMapEntry
+	{
+		GLuint textureID;
+		unsigned int refCount;
+	};
+
+	static GLuint LoadCubeMap(const vector<string>& faceLocations);
+	static GLuint LoadCubeMapKtx(const vector<string>& faceLocations);
+
+	static unordered_map<string, TextureEntry> textures;
+	static unordered_map<string, CubeMapEntry> cubeMaps;
+
+	static unsigned int hitCount, missCount;
+};
@@ -0,0 +1,298 @@
+#include "TextureLoader.h"
+
+vector<thread> TextureLoader::workers;
+mutex TextureLoader::queueMutex;
+condition_variable TextureLoader::queueCondition;
+deque<TextureLoader::DecodeJob> TextureLoader::queuedJobs;
+deque<TextureLoader::DecodeJob> TextureLoader::decodedJobs;
+unordered_map<unsigned int, GLuint> TextureLoader::liveTickets;
+unsigned int TextureLoader::nextTicket = 1;
+unsigned int TextureLoader::jobsInFlight = 0;
+bool TextureLoader::stopping = false;
+
+unordered_map<GLuint, TextureLoader::TextureState> TextureLoader::textureStates;
+GLuint TextureLoader::uploadBuffer = 0;
+
+void TextureLoader::Start()
+{
+	unsigned int threadCount = thread::hardware_concurrency();
+	threadCount = threadCount > 1 ? threadCount - 1 : 1;
+
+	stopping = false;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(thread(WorkerLoop));
+	}
+}
+
+void TextureLoader::Stop()
+{
+	{
+		lock_guard<mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+
+	for (size_t i = 0; i < decodedJobs.size(); i++)
+	{
+		stbi_image_free(decodedJobs[i].data);
+	}
+	queuedJobs.clear();
+	decodedJobs.clear();
+	liveTickets.clear();
+	jobsInFlight = 0;
+
+	textureStates.clear();
+
+	if (uploadBuffer != 0)
+	{
+		glDeleteBuffers(1, &uploadBuffer);
+		uploadBuffer = 0;
+	}
+}
+
+void TextureLoader::LoadAsync(const vector<string>& fileLocations, int channels, GLuint textureID, GLenum target)
+{
+	if (workers.empty())
+	{
+		Start();
+	}
+
+	TextureState state = { target, (unsigned int)fileLocations.size(), false, 0, 0, (int)fileLocations.size() };
+	textureStates[textureID] = state;
+
+	{
+		lock_guard<mutex> lock(queueMutex);
+
+		for (size_t i = 0; i < fileLocations.size(); i++)
+		{
+			DecodeJob job = { nextTicket++, fileLocations[i], channels, textureID, (GLint)i, nullptr, 0, 0 };
+			liveTickets[job.ticket] = textureID;
+			queuedJobs.push_back(job);
+			jobsInFlight++;
+		}
+	}
+	queueCondition.notify_all();
+}
+
+void TextureLoader::Cancel(GLuint textureID)
+{
+	if (textureStates.erase(textureID) == 0)
+	{
+		return;
+	}
+
+	lock_guard<mutex> lock(queueMutex);
+
+	for (auto it = liveTickets.begin(); it != liveTickets.end();)
+	{
+		if (it->second == textureID)
+		{
+			it = liveTickets.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void TextureLoader::WorkerLoop()
+{
+	CpuProfiler::SetThreadName("Texture decode");
+
+	while (true)
+	{
+		DecodeJob job;
+		{
+			unique_lock<mutex> lock(queueMutex);
+			queueCondition.wait(lock, [] { return stopping || !queuedJobs.empty(); });
+
+			if (stopping)
+			{
+				return;
+			}
+
+			job = queuedJobs.front();
+			queuedJobs.pop_front();
+
+			if (liveTickets.find(job.ticket) == liveTickets.end())
+			{
+				jobsInFlight--;
+				continue;
+			}
+		}
+
+		int bitDepth;
+		{
+			CPU_ZONE("stbi_load");
+			job.data = stbi_load(job.fileLocation.c_str(), &job.width, &job.height, &bitDepth, job.channels);
+		}
+
+		if (!job.data)
+		{
+			cout << "Failed to find:\t" << job.fileLocation << endl;
+		}
+
+		lock_guard<mutex> lock(queueMutex);
+		decodedJobs.push_back(job);
+	}
+}
+
+unsigned int TextureLoader::Update()
+{
+	deque<DecodeJob> finished;
+	{
+		lock_guard<mutex> lock(queueMutex);
+		finished.swap(decodedJobs);
+	}
+
+	unsigned int committed = 0;
+
+	for (size_t i = 0; i < finished.size(); i++)
+	{
+		bool live;
+		{
+			lock_guard<mutex> lock(queueMutex);
+			live = liveTickets.erase(finished[i].ticket) != 0;
+			jobsInFlight--;
+		}
+
+		if (live && finished[i].data)
+		{
+			Commit(finished[i]);
+			committed++;
+		}
+		else if (live)
+		{
+			//Failed decode, the placeholder stays.
+			auto state = textureStates.find(finished[i].textureID);
+			if (state != textureStates.end() && --state->second.pending == 0)
+			{
+				if (state->second.allocated)
+				{
+					GLState::BindTexture(state->second.target, finished[i].textureID);
+					glTexParameteri(state->second.target, GL_TEXTURE_MAX_LEVEL, 1000);
+					glGenerateMipmap(state->second.target);
+					GLState::BindTexture(state->second.target, 0);
+				}
+				textureStates.erase(state);
+			}
+		}
+
+		if (finished[i].data)
+		{
+			stbi_image_free(finished[i].data);
+		}
+	}
+
+	return committed;
+}
+
+void TextureLoader::Commit(DecodeJob& job)
+{
+	auto found = textureStates.find(job.textureID);
+	if (found == textureStates.end())
+	{
+		return;
+	}
+	TextureState& state = found->second;
+	GLenum target = state.target;
+
+	GLenum format = job.channels == 4 ? GL_RGBA : GL_RGB;
+	GLsizeiptr size = (GLsizeiptr)job.width * job.height * job.channels;
+
+	//Stage the pixels in a PBO so the copy to the texture runs asynchronously.
+	if (uploadBuffer == 0)
+	{
+		glGenBuffers(1, &uploadBuffer);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW); //Orphan the previous upload.
+
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped)
+	{
+		memcpy(mapped, job.data, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	GLState::BindTexture(target, job.textureID);
+
+	const void* pixels = mapped ? nullptr : job.data;
+	if (!mapped)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	if (target == GL_TEXTURE_2D)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, format, job.width, job.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+	}
+	else if (target == GL_TEXTURE_CUBE_MAP)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + job.layer, 0, format, job.width, job.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+	}
+	else if (target == GL_TEXTURE_2D_ARRAY)
+	{
+		//The first layer to arrive decides the array size.
+		if (!state.allocated)
+		{
+			state.width = job.width;
+			state.height = job.height;
+			state.allocated = true;
+
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, state.width, state.height, state.layers, 0, format, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mapped ? uploadBuffer : 0);
+
+			//Keep sampling level 0 until every layer is in and the mips are built.
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+		}
+
+		if (job.width == state.width && job.height == state.height)
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, job.layer, job.width, job.height, 1, format, GL_UNSIGNED_BYTE, pixels);
+		}
+		else
+		{
+			printf("%s is %dx%d, the texture array is %dx%d\n", job.fileLocation.c_str(), job.width, job.height, state.width, state.height);
+		}
+	}
+
+	//Mips for every target, as cooked textures come with theirs.
+	if (--state.pending == 0)
+	{
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 1000);
+		glGenerateMipmap(target);
+		textureStates.erase(found);
+	}
+
+	GLState::BindTexture(target, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureLoader::WaitAll()
+{
+	while (!IsIdle())
+	{
+		if (Update() == 0)
+		{
+			this_thread::yield();
+		}
+	}
+}
+
+bool TextureLoader::IsIdle()
+{
+	lock_guard<mutex> lock(queueMutex);
+	return jobsInFlight == 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <GL\glew.h>
+
+#include "CommonValues.h"
+#include "GLState.h"
+#include "CpuProfiler.h"
+
+using namespace std;
+
+//Decodes image files on a pool of worker threads. The GL thread commits finished
+//images through a pixel buffer object in Update(); until then the texture keeps
+//whatever placeholder its owner uploaded.
+class TextureLoader
+{
+public:
+	//target is GL_TEXTURE_2D (one file), GL_TEXTURE_CUBE_MAP (six faces) or GL_TEXTURE_2D_ARRAY (one file per layer).
+	static void LoadAsync(const vector<string>& fileLocations, int channels, GLuint textureID, GLenum target);
+	static void Cancel(GLuint textureID);
+
+	static unsigned int Update();
+	static void WaitAll();
+	static bool IsIdle();
+
+	static void Stop();
+
+private:
+	struct DecodeJob
+	{
+		unsigned int ticket;
+		string fileLocation;
+		int channels;
+		GLuint textureID;
+		GLint layer;
+
+		unsigned char* data;
+		int width, height;
+	};
+
+	struct TextureState
+	{
+		GLenum target;
+		unsigned int pending;
+		bool allocated;
+		int width, height, layers;
+	};
+
+	static void Start();
+	static void WorkerLoop();
+	static void Commit(DecodeJob& job);
+
+	static vector<thread> workers;
+	static mutex queueMutex;
+	static condition_variable queueCondition;
+	static deque<DecodeJob> queuedJobs;
+	static deque<DecodeJob> decodedJobs;
+	static unordered_map<unsigned int, GLuint> liveTickets;
+	static unsigned int nextTicket;
+	static unsigned int jobsInFlight;
+	static bool stopping;
+
+	//Only touched on the GL thread.
+	static unordered_map<GLuint, TextureState> textureStates;
+	static GLuint uploadBuffer;
+};
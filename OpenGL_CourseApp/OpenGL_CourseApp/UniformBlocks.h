@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <GL\glew.h>
+#include <glm\glm.hpp>
+
+#include "CommonValues.h"
+
+//Binding points shared by every program, see Shader::CompileProgram.
+const GLuint FRAME_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+
+//std140 mirrors of the uniform blocks in shader.vert.txt and shader.frag.txt.
+//Every struct member is aligned to 16 bytes and vec3s take a whole vec4 slot
+//unless a float follows, so the padding below is what the shaders expect.
+
+struct LightBlock
+{
+	glm::vec3 colour;
+	GLfloat ambientIntensity;
+	GLfloat diffuseIntensity;
+	GLfloat padding[3];
+};
+
+struct DirectionalLightBlock
+{
+	LightBlock base;
+	glm::vec3 direction;
+	GLfloat padding;
+};
+
+struct PointLightBlock
+{
+	LightBlock base;
+	glm::vec3 position;
+	GLfloat constant;
+	GLfloat linear;
+	GLfloat exponent;
+	GLfloat padding[2];
+};
+
+struct SpotLightBlock
+{
+	PointLightBlock base;
+	glm::vec3 direction;
+	GLfloat edge;
+};
+
+//uniform Frame, camera and per-frame data.
+struct FrameBlock
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 directionalLightTransform;
+	glm::vec3 eyePosition;
+	GLfloat padding;
+};
+
+//uniform Lights, every shadowed light.
+struct LightsBlock
+{
+	DirectionalLightBlock directionalLight;
+	PointLightBlock pointLights[MAX_POINT_LIGHTS];
+	SpotLightBlock spotLights[MAX_SPOT_LIGHTS];
+	GLint pointLightCount;
+	GLint spotLightCount;
+	GLint padding[2];
+};
+
+static_assert(sizeof(LightBlock) == 32, "LightBlock does not match std140");
+static_assert(sizeof(DirectionalLightBlock) == 48, "DirectionalLightBlock does not match std140");
+static_assert(sizeof(PointLightBlock) == 64, "PointLightBlock does not match std140");
+static_assert(sizeof(SpotLightBlock) == 80, "SpotLightBlock does not match std140");
+static_assert(offsetof(FrameBlock, eyePosition) == 192, "FrameBlock does not match std140");
+static_assert(offsetof(LightsBlock, pointLights) == 48, "LightsBlock does not match std140");
+static_assert(offsetof(LightsBlock, pointLightCount) == 48 + 64 * MAX_POINT_LIGHTS + 80 * MAX_SPOT_LIGHTS, "LightsBlock does not match std140");
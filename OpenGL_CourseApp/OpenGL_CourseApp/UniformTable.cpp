@@ -0,0 +1,131 @@
+#include "UniformTable.h"
+
+vector<string> UniformTable::names;
+UniformTable::Entry UniformTable::table[UniformTable::TABLE_SIZE];
+
+void UniformTable::BuildNames()
+{
+	names.resize(UNIFORM_COUNT);
+
+	names[UNIFORM_MODEL] = "model";
+	names[UNIFORM_PROJECTION] = "projection";
+	names[UNIFORM_VIEW] = "view";
+	names[UNIFORM_INSTANCED] = "instanced";
+	names[UNIFORM_SPECULAR_INTENSITY] = "material.specularIntensity";
+	names[UNIFORM_SHININESS] = "material.shininess";
+	names[UNIFORM_DIRECTIONAL_LIGHT_TRANSFORM] = "directionalLightTransform";
+	names[UNIFORM_TEXTURE] = "theTexture";
+	names[UNIFORM_TEXTURE_ARRAY] = "theTextureArray";
+	names[UNIFORM_USE_TEXTURE_ARRAY] = "useTextureArray";
+	names[UNIFORM_DIRECTIONAL_SHADOW_MAP] = "directionalShadowMap";
+	names[UNIFORM_OMNI_LIGHT_POS] = "lightPos";
+	names[UNIFORM_FAR_PLANE] = "farPlane";
+	names[UNIFORM_FACE] = "face";
+	names[UNIFORM_CLUSTER_LIGHTS] = "clusterLights";
+	names[UNIFORM_CLUSTER_GRID] = "clusterGrid";
+	names[UNIFORM_CLUSTER_INDICES] = "clusterIndices";
+	names[UNIFORM_CLUSTER_TILE_SCALE] = "clusterTileScale";
+	names[UNIFORM_CLUSTER_SLICES] = "clusterSlices";
+
+	char name[64];
+	for (int i = 0; i < 6; i++)
+	{
+		snprintf(name, sizeof(name), "lightMatrices[%d]", i);
+		names[UNIFORM_LIGHT_MATRICES + i] = name;
+	}
+
+	for (int i = 0; i < MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS; i++)
+	{
+		snprintf(name, sizeof(name), "omniShadowMaps[%d].shadowMap", i);
+		names[UNIFORM_OMNI_SHADOW_MAPS + i] = name;
+
+		snprintf(name, sizeof(name), "omniShadowMaps[%d].farPlane", i);
+		names[UNIFORM_OMNI_FAR_PLANES + i] = name;
+	}
+
+	for (size_t i = 0; i < TABLE_SIZE; i++)
+	{
+		table[i].id = -1;
+	}
+
+	for (int id = 0; id < UNIFORM_COUNT; id++)
+	{
+		uint64_t hash = HashBytes(names[id].c_str(), names[id].size());
+		size_t slot = hash & (TABLE_SIZE - 1);
+		while (table[slot].id >= 0)
+		{
+			slot = (slot + 1) & (TABLE_SIZE - 1);
+		}
+
+		table[slot].hash = hash;
+		table[slot].id = id;
+	}
+}
+
+int UniformTable::Find(const char* name)
+{
+	if (names.empty())
+	{
+		BuildNames();
+	}
+
+	uint64_t hash = HashBytes(name, strlen(name));
+	for (size_t slot = hash & (TABLE_SIZE - 1); table[slot].id >= 0; slot = (slot + 1) & (TABLE_SIZE - 1))
+	{
+		if (table[slot].hash == hash && names[table[slot].id] == name)
+		{
+			return table[slot].id;
+		}
+	}
+
+	return -1;
+}
+
+void UniformTable::Reflect(GLuint program, GLint* locations)
+{
+	for (int id = 0; id < UNIFORM_COUNT; id++)
+	{
+		locations[id] = -1;
+	}
+
+	GLint uniformCount = 0, maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	vector<GLchar> name(maxLength + 16);
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, (GLuint)i, maxLength, &length, &size, &type, &name[0]);
+
+		//Block members have no location, they are fed through uniform buffers.
+		GLint location = glGetUniformLocation(program, &name[0]);
+		if (location < 0)
+		{
+			continue;
+		}
+
+		int id = Find(&name[0]);
+		if (id >= 0)
+		{
+			locations[id] = location;
+		}
+
+		//Arrays of plain types are reported once as "name[0]", look up the other elements.
+		if (size > 1 && length > 3 && strcmp(&name[length - 3], "[0]") == 0)
+		{
+			string base(&name[0], length - 3);
+			for (GLint element = 1; element < size; element++)
+			{
+				string elementName = base + "[" + to_string(element) + "]";
+				id = Find(elementName.c_str());
+				if (id >= 0)
+				{
+					locations[id] = glGetUniformLocation(program, elementName.c_str());
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include "CommonValues.h"
+#include "Hash.h"
+
+using namespace std;
+
+//Every uniform the engine sets, as a fixed slot in each program's location table.
+//Arrays take one slot per element.
+enum UniformID
+{
+	UNIFORM_MODEL,
+	UNIFORM_PROJECTION,
+	UNIFORM_VIEW,
+	UNIFORM_INSTANCED,
+	UNIFORM_SPECULAR_INTENSITY,
+	UNIFORM_SHININESS,
+	UNIFORM_DIRECTIONAL_LIGHT_TRANSFORM,
+	UNIFORM_TEXTURE,
+	UNIFORM_TEXTURE_ARRAY,
+	UNIFORM_USE_TEXTURE_ARRAY,
+	UNIFORM_DIRECTIONAL_SHADOW_MAP,
+	UNIFORM_OMNI_LIGHT_POS,
+	UNIFORM_FAR_PLANE,
+	UNIFORM_FACE,
+	UNIFORM_CLUSTER_LIGHTS,
+	UNIFORM_CLUSTER_GRID,
+	UNIFORM_CLUSTER_INDICES,
+	UNIFORM_CLUSTER_TILE_SCALE,
+	UNIFORM_CLUSTER_SLICES,
+	UNIFORM_LIGHT_MATRICES,
+	UNIFORM_OMNI_SHADOW_MAPS = UNIFORM_LIGHT_MATRICES + 6,
+	UNIFORM_OMNI_FAR_PLANES = UNIFORM_OMNI_SHADOW_MAPS + MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS,
+	UNIFORM_COUNT = UNIFORM_OMNI_FAR_PLANES + MAX_POINT_LIGHTS + MAX_SPOT_LIGHTS
+};
+
+//Fills a program's location table from its active uniforms right after linking.
+//Names are hashed into a flat open-addressed table built once per run, so reflection
+//never formats strings for uniforms a program doesn't have and lookups at draw time
+//are plain array reads.
+class UniformTable
+{
+public:
+	static void Reflect(GLuint program, GLint* locations); //locations holds UNIFORM_COUNT entries.
+
+	static int Find(const char* name); //UniformID, or -1 for uniforms the engine doesn't set.
+
+private:
+	static void BuildNames();
+
+	static const size_t TABLE_SIZE = 256; //Power of two, well over twice UNIFORM_COUNT.
+
+	struct Entry
+	{
+		uint64_t hash;
+		int id;
+	};
+
+	static vector<string> names;
+	static Entry table[TABLE_SIZE];
+};
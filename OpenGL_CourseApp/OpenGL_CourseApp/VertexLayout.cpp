@@ -0,0 +1,184 @@
+#include "VertexLayout.h"
+
+#include <stdio.h>
+#include <math.h>
+
+void VertexPacking::PackMesh(const GLfloat* vertices, unsigned int numOfVertices, const unsigned int* indices, unsigned int numOfIndices,
+	vector<PackedMesh>& packed)
+{
+	const FloatVertex* source = (const FloatVertex*)vertices;
+	unsigned int vertexCount = numOfVertices / 8;
+
+	//The common case keeps the vertex order, so the indices carry straight over.
+	if (vertexCount <= MAX_PACKED_VERTICES)
+	{
+		packed.push_back(PackedMesh());
+		PackedMesh& mesh = packed.back();
+
+		mesh.vertices.resize(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			mesh.vertices[v] = PackVertex(source[v]);
+		}
+
+		mesh.indices.assign(indices, indices + numOfIndices);
+		return;
+	}
+
+	//Otherwise fill pieces triangle by triangle, each with its own vertex numbering.
+	vector<int> remap(vertexCount, -1);
+	vector<unsigned int> touched;
+	size_t first = packed.size();
+	packed.push_back(PackedMesh());
+
+	for (unsigned int t = 0; t + 2 < numOfIndices; t += 3)
+	{
+		PackedMesh* mesh = &packed.back();
+
+		unsigned int newVertices = 0;
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			if (remap[indices[t + k]] < 0) newVertices++;
+		}
+
+		if (mesh->vertices.size() + newVertices > MAX_PACKED_VERTICES)
+		{
+			for (size_t i = 0; i < touched.size(); i++)
+			{
+				remap[touched[i]] = -1;
+			}
+			touched.clear();
+
+			packed.push_back(PackedMesh());
+			mesh = &packed.back();
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			unsigned int index = indices[t + k];
+			if (remap[index] < 0)
+			{
+				remap[index] = mesh->vertices.size();
+				touched.push_back(index);
+				mesh->vertices.push_back(PackVertex(source[index]));
+			}
+
+			mesh->indices.push_back((PackedIndex)remap[index]);
+		}
+	}
+
+	printf("Split a mesh of %u vertices into %zu pieces for 16-bit indices\n", vertexCount, packed.size() - first);
+}
+
+PackedVertex VertexPacking::PackVertex(const FloatVertex& vertex)
+{
+	PackedVertex packed;
+
+	packed.position[0] = FloatToHalf(vertex.position[0]);
+	packed.position[1] = FloatToHalf(vertex.position[1]);
+	packed.position[2] = FloatToHalf(vertex.position[2]);
+	packed.position[3] = FloatToHalf(1.0f);
+
+	packed.texCoord[0] = FloatToHalf(vertex.texCoord[0]);
+	packed.texCoord[1] = FloatToHalf(vertex.texCoord[1]);
+
+	EncodeOctahedral(glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]), packed.normal);
+
+	return packed;
+}
+
+glm::vec3 VertexPacking::GetPosition(const PackedVertex& vertex)
+{
+	return glm::vec3(HalfToFloat(vertex.position[0]), HalfToFloat(vertex.position[1]), HalfToFloat(vertex.position[2]));
+}
+
+uint16_t VertexPacking::FloatToHalf(GLfloat value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	//NaN stays NaN, infinity and anything past the largest half become infinity.
+	if (magnitude > 0x7F800000)
+	{
+		return sign | 0x7E00;
+	}
+	if (magnitude >= 0x47800000)
+	{
+		return sign | 0x7C00;
+	}
+
+	//Below the smallest normal half: a subnormal with the mantissa shifted down, or zero.
+	if (magnitude < 0x38800000)
+	{
+		if (magnitude < 0x33000000)
+		{
+			return sign;
+		}
+
+		uint32_t exponent = magnitude >> 23;
+		uint32_t mantissa = (magnitude & 0x007FFFFF) | 0x00800000;
+		uint32_t shift = 126 - exponent;
+
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t midpoint = 1u << (shift - 1);
+		if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+		{
+			half++;
+		}
+
+		return sign | (uint16_t)half;
+	}
+
+	//Rebias the exponent from 127 to 15 and round the dropped 13 bits to nearest even.
+	//A carry out of the mantissa correctly bumps the exponent, up to infinity.
+	uint32_t half = (magnitude - 0x38000000) >> 13;
+	uint32_t remainder = magnitude & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+
+	return sign | (uint16_t)half;
+}
+
+GLfloat VertexPacking::HalfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	if (exponent == 0)
+	{
+		GLfloat value = ldexpf((GLfloat)mantissa, -24);
+		return sign ? -value : value;
+	}
+
+	uint32_t bits = exponent == 31 ? (sign | 0x7F800000 | (mantissa << 13)) : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+
+	GLfloat value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+void VertexPacking::EncodeOctahedral(glm::vec3 normal, int16_t encoded[2])
+{
+	//Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the diagonals.
+	GLfloat length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	GLfloat x = length > 0.0f ? normal.x / length : 0.0f;
+	GLfloat y = length > 0.0f ? normal.y / length : 0.0f;
+
+	if (normal.z < 0.0f)
+	{
+		GLfloat foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		GLfloat foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = (int16_t)lroundf(glm::clamp(x, -1.0f, 1.0f) * 32767.0f);
+	encoded[1] = (int16_t)lroundf(glm::clamp(y, -1.0f, 1.0f) * 32767.0f);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include <GL\glew.h>
+
+#include <glm\glm.hpp>
+
+using namespace std;
+
+//One attribute of a vertex struct, as glVertexAttribPointer takes it.
+struct VertexAttribute
+{
+	GLuint location;
+	GLint components;
+	GLenum type;
+	GLboolean normalized;
+	size_t offset;
+};
+
+//Specialised for every vertex struct that goes to the GPU, listing its attributes.
+template <typename Vertex>
+struct VertexLayout;
+
+//The interleaved 8-float layout meshes are built in before packing.
+struct FloatVertex
+{
+	GLfloat position[3];
+	GLfloat texCoord[2];
+	GLfloat normal[3];
+};
+
+//16 bytes instead of 32: half-float position (w only pads it to 8 bytes), half-float
+//texture coordinates so repeating UVs above 1 survive, and an octahedral normal in two snorm16.
+struct PackedVertex
+{
+	uint16_t position[4];
+	uint16_t texCoord[2];
+	int16_t normal[2];
+};
+
+//Packed meshes index with 16 bits, so none of them has more vertices than this.
+typedef uint16_t PackedIndex;
+static const unsigned int MAX_PACKED_VERTICES = 65536;
+
+//shader.vert decodes location 2 back into a normal, the shadow shaders only read location 0.
+template <>
+struct VertexLayout<PackedVertex>
+{
+	static const unsigned int ATTRIBUTE_COUNT = 3;
+	static const VertexAttribute* GetAttributes()
+	{
+		static const VertexAttribute attributes[ATTRIBUTE_COUNT] =
+		{
+			{ 0, 4, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, position) },
+			{ 1, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, texCoord) },
+			{ 2, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, normal) }
+		};
+		return attributes;
+	}
+};
+
+//Points the bound VAO's attributes at the bound GL_ARRAY_BUFFER, laid out as Vertex.
+template <typename Vertex>
+void ApplyVertexLayout()
+{
+	const VertexAttribute* attributes = VertexLayout<Vertex>::GetAttributes();
+	for (unsigned int i = 0; i < VertexLayout<Vertex>::ATTRIBUTE_COUNT; i++)
+	{
+		glVertexAttribPointer(attributes[i].location, attributes[i].components, attributes[i].type, attributes[i].normalized,
+			sizeof(Vertex), (void*)attributes[i].offset);
+		glEnableVertexAttribArray(attributes[i].location);
+	}
+}
+
+//Converts the 8-float layout into PackedVertex and 16-bit indices.
+class VertexPacking
+{
+public:
+	struct PackedMesh
+	{
+		vector<PackedVertex> vertices;
+		vector<PackedIndex> indices;
+	};
+
+	//numOfVertices counts floats, as Mesh::CreateMesh does. Meshes with more vertices
+	//than 16-bit indices reach are split by triangles into several packed meshes.
+	static void PackMesh(const GLfloat* vertices, unsigned int numOfVertices, const unsigned int* indices, unsigned int numOfIndices,
+		vector<PackedMesh>& packed);
+
+	static PackedVertex PackVertex(const FloatVertex& vertex);
+	static glm::vec3 GetPosition(const PackedVertex& vertex);
+
+	static uint16_t FloatToHalf(GLfloat value);
+	static GLfloat HalfToFloat(uint16_t half);
+
+	static void EncodeOctahedral(glm::vec3 normal, int16_t encoded[2]);
+};
@@ -22,8 +22,16 @@ Window::Window(GLint windowWidth, GLint windowHeight)
 	}
 }
 
-int Window::Initialise()
+int Window::Initialise(bool headless)
 {
+#ifdef GLFW_PLATFORM_NULL
+	//GLFW 3.4+ can run without any display server.
+	if (headless)
+	{
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+#endif
+
 	//Initialise GLFW:
 	if (!glfwInit())
 	{
@@ -41,6 +49,14 @@ int Window::Initialise()
 	// Allow forward compatiblity
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
+	if (headless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GLFW_PLATFORM_NULL
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+	}
+
 	// Create the window
 	mainWindow = glfwCreateWindow(width, height, "Test Window", NULL, NULL);
 	if (!mainWindow)
@@ -58,12 +74,27 @@ int Window::Initialise()
 
 	//Handle key + mouse Input:
 	createCallbacks();
-	glfwSetInputMode(mainWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	if (headless)
+	{
+		glfwSwapInterval(0);
+	}
+	else
+	{
+		glfwSetInputMode(mainWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
 	// Allow modern extension access 	//Allow modern extension features:
 	glewExperimental = GL_TRUE;
 
 	GLenum error = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	//OSMesa contexts have no GLX display, the GL entry points still load.
+	if (headless && error == GLEW_ERROR_NO_GLX_DISPLAY)
+	{
+		error = GLEW_OK;
+	}
+#endif
 	if (error != GLEW_OK)
 	{
 		printf("Error: %s", glewGetErrorString(error));
@@ -78,6 +109,8 @@ int Window::Initialise()
 	glViewport(0, 0, bufferWidth, bufferHeight);
 
 	glfwSetWindowUserPointer(mainWindow, this);
+
+	return 0;
 }
 
 void Window::createCallbacks()
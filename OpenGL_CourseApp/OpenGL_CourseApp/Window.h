@@ -14,7 +14,7 @@ public:
 	Window();
 	Window(GLint windowWidth, GLint windowHeight);
 
-	int Initialise();
+	int Initialise(bool headless = false); //Headless: hidden, offscreen-capable context without vsync.
 
 	GLint getBufferWidth() { return bufferWidth; }
 	GLint getBufferHeight() { return bufferHeight; }
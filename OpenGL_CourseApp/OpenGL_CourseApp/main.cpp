@@ -17,6 +17,7 @@
 #include "Shader.h"
 #include "Camera.h"
 #include "Texture.h"
+#include "TextureCache.h"
 #include "Light.h"
 #include "Material.h"
 #include "DirectionalLight.h"
@@ -25,14 +26,21 @@
 #include "SpotLight.h"
 #include "Model.h"
 #include "Skybox.h"
+#include "Scene.h"
+#include "Benchmark.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "FrameUniforms.h"
+#include "GLState.h"
 
 #include <assimp/Importer.hpp>
 
 const float PI = 3.141592653589793238462643383;
 const float toRadians = 3.14159265f / 180.0f;
 
-GLuint uniformProjection = 0, uniformModel = 0, uniformView = 0,
-uniformEyePosition = 0, uniformSpecularIntensity = 0, uniformShininess = 0, uniformOmniLightPos = 0, uniformFarPlane = 0;
+GLuint uniformModel = 0,
+uniformSpecularIntensity = 0, uniformShininess = 0, uniformOmniLightPos = 0, uniformFarPlane = 0,
+uniformInstanced = 0, uniformUseTextureArray = 0;
 
 #pragma region Variables
 Window mainWindow;
@@ -40,18 +48,34 @@ std::vector<Mesh*> meshList;
 std::vector<Shader> shaderList;
 Shader directionalShadowShader;
 Shader omniShadowShader;
+Shader omniLayeredShader;
+Shader omniFaceShader;
+
+//How omni shadow cube maps are filled, O cycles through them at runtime.
+enum OmniShadowMode
+{
+	OMNI_GEOMETRY_SHADER,	//One pass, the geometry shader emits each triangle to all six faces.
+	OMNI_LAYERED,			//One pass, six instances per body, the vertex shader writes gl_Layer.
+	OMNI_PER_FACE,			//Six passes, one face attached at a time.
+	OMNI_MODE_COUNT
+};
+
+static const char* omniShadowModeNames[OMNI_MODE_COUNT] = { "geometry", "layered", "faces" };
+
+OmniShadowMode omniShadowMode = OMNI_GEOMETRY_SHADER;
+bool layeredShadowsSupported = false;
 
 Camera camera;
 
-Texture brickTexture;
-Texture dirtTexture;
-Texture plainTexture;
+Texture* brickTexture;
+Texture* dirtTexture;
+Texture* plainTexture;
 
 DirectionalLight mainLight;
 PointLight pointLights[MAX_POINT_LIGHTS];
 SpotLight spotLights[MAX_SPOT_LIGHTS];
 
-Skybox skyBox;
+Skybox* skyBox;
 
 unsigned int pointLightCount = 0;
 unsigned int spotLightCount = 0;
@@ -63,19 +87,19 @@ Material dullMaterial;
 #pragma region PlanetModels
 Model xWing;
 Model blackHawk;
-Model earthPlanet;
-Model moon;
-Model sun;
-Model mercury;
-Model saturn;
-Model venus;
-Model mars;
-Model jupiter;
-Model uranus;
-Model neptune;
-Model orbit;
+
+Scene solarSystem;
 #pragma endregion
 
+ClusteredLights clusteredLights;
+FrameUniforms frameUniforms;
+
+Benchmark benchmark;
+
+//Target of the main pass: the window, or the offscreen framebuffer when benchmarking.
+GLuint sceneFramebuffer = 0;
+GLint sceneWidth = 0, sceneHeight = 0;
+
 GLfloat deltaTime = 0.0f;
 GLfloat lastTime = 0.0f;
 GLfloat dirX, dirY, dirZ;
@@ -103,6 +127,13 @@ static const char* gfShader = "Shaders/omni_shadowmap.frag.txt";
 //OmniShadow Geom Shader.
 static const char* gShader = "Shaders/omni_shadowmap.geom.txt";
 
+//OmniShadow Vertex Shaders without a geometry shader.
+static const char* glvShader = "Shaders/omni_shadowmap_layered.vert.txt";
+static const char* gfvShader = "Shaders/omni_shadowmap_face.vert.txt";
+
+//Celestial bodies.
+static const char* sceneFile = "Scenes/SolarSystem.txt";
+
 #pragma endregion
 
 void calcAverageNormals(unsigned int * indices, unsigned int indiceCount, GLfloat * vertices, unsigned int verticeCount,
@@ -202,9 +233,42 @@ void CreateShaders()
 
 	omniShadowShader = Shader();
 	omniShadowShader.CreateFromFiles(gvShader, gShader, gfShader);
+
+	omniFaceShader = Shader();
+	omniFaceShader.CreateFromFiles(gfvShader, gfShader);
+
+	//gl_Layer from a vertex shader needs an extension on a 3.3 context.
+	layeredShadowsSupported = GLEW_ARB_shader_viewport_layer_array || GLEW_AMD_vertex_shader_layer;
+	if (layeredShadowsSupported)
+	{
+		omniLayeredShader = Shader();
+		omniLayeredShader.CreateFromFiles(glvShader, gfShader);
+	}
+}
+
+Shader* GetOmniShader()
+{
+	switch (omniShadowMode)
+	{
+	case OMNI_LAYERED: return &omniLayeredShader;
+	case OMNI_PER_FACE: return &omniFaceShader;
+	default: return &omniShadowShader;
+	}
 }
 
-void RenderScene()
+void SetOmniShadowMode(OmniShadowMode mode)
+{
+	if (mode == OMNI_LAYERED && !layeredShadowsSupported)
+	{
+		printf("Omni shadows: layered mode needs ARB_shader_viewport_layer_array, using faces\n");
+		mode = OMNI_PER_FACE;
+	}
+
+	omniShadowMode = mode;
+	printf("Omni shadows: %s\n", omniShadowModeNames[mode]);
+}
+
+void RenderScene(RenderPassID pass, CasterSet casters = ALL_CASTERS, GLsizei views = 1, bool culled = false)
 {
 	glm::mat4 model;
 
@@ -212,7 +276,7 @@ void RenderScene()
 	//model = glm::translate(model, glm::vec3(0.0f, 0.0f, -2.5f));
 	////model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
 	//glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	//brickTexture.UseTexture();
+	//brickTexture->UseTexture();
 	//shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
 	//meshList[0]->RenderMesh();
 
@@ -220,7 +284,7 @@ void RenderScene()
 	//model = glm::translate(model, glm::vec3(0.0f, 4.0f, -2.5f));
 	////model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
 	//glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	//dirtTexture.UseTexture();
+	//dirtTexture->UseTexture();
 	//dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
 	//meshList[1]->RenderMesh();
 
@@ -228,7 +292,7 @@ void RenderScene()
 	//model = glm::translate(model, glm::vec3(0.0f, -2.0f, 0.0f));
 	////model = glm::scale(model, glm::vec3(0.4f, 0.4f, 1.0f));
 	//glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	//dirtTexture.UseTexture();
+	//dirtTexture->UseTexture();
 	//dullMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
 	//meshList[2]->RenderMesh();
 
@@ -258,231 +322,14 @@ void RenderScene()
 
 #pragma endregion
 
-	angle += 2.0f * deltaTime;
-
-	#pragma region PlanetsInit
-
-#pragma region  Sun
-	//Sun.
-	model = glm::mat4();
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.004f, 0.004f, 0.004f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	sun.RenderModel();
-#pragma endregion
-
-#pragma region Mercury
-	//Mercury.
-	model = glm::mat4();
-	model = glm::rotate(model, 7.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 88.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(2.0f * 3, 8.0f, 0.0f));
-	model = glm::rotate(model, toRadians * (angle / 59.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.001f, 0.001f, 0.001f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	mercury.RenderModel();
-
-	//Mercury Orbit.
-	model = glm::mat4();
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(1.3f, 1.3f, 1.3f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-#pragma endregion
-
-#pragma region Venus
-	//Venus.
-	model = glm::mat4();
-	model = glm::rotate(model, 3.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 225), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(3.0f * 4, 8.0f, 0.0f));
-	model = glm::rotate(model, toRadians * (angle / -243.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.002f, 0.002f, 0.002f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	venus.RenderModel();
-
-	//Venus Orbit.
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(2.5f, 2.5f, 2.5f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-#pragma endregion
-
-#pragma region Earth 
-	//Earth.
-	model = glm::mat4();
-	model = glm::rotate(model, 7.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 365.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(8.0f * 3, 8.0f, 0.0f)); //x=3.5f.
-	model = glm::rotate(model, toRadians * angle, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.8f, 0.8f, 0.8f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	earthPlanet.RenderModel();
-
-	//Earth Orbit.
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(5.2f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-
-#pragma endregion
-
-#pragma region Moon
-	//Moon.
-	model = glm::mat4();
-	model = glm::rotate(model, 7.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 365.0f), glm::vec3(0.0f, 1.0f, 0.0f));  //Revolution.
-	model = glm::translate(model, glm::vec3(8.0f * 3, 8.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 30), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(5.0f, 0.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.001f, 0.001f, 0.001f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	moon.RenderModel();
-
-	//Moon Orbit.
-	model = glm::mat4();
-	model = glm::rotate(model, 7.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 365.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(8.0f * 3, 8.0f, 0.0f)); //x=3.5f.
-	model = glm::rotate(model, toRadians * angle, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-#pragma endregion
-
-#pragma region Mars
-	//Mars.
-	model = glm::mat4();
-	model = glm::rotate(model, 2.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 686), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(12 * 3, 8.0f, 0.0f)); //x=3.5f.
-	model = glm::rotate(model, toRadians* (angle / 1), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.002f, 0.002f, 0.002f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	mars.RenderModel();
-
-	//Mars Orbit.
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(7.8f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-#pragma endregion
-
-#pragma region Jupiter
-	//Jupiter.
-	model = glm::mat4();
-	model = glm::rotate(model, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 4333), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(15 * 3, 8.0f, 0.0f)); //x=3.5f.
-	model = glm::rotate(model, toRadians* (angle / 0.4f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.003f, 0.003f, 0.003f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	jupiter.RenderModel();
-
-	//Jupiter Orbit.
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(9.6f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-#pragma endregion
-
-#pragma region Saturn
-	//Saturn.
-	model = glm::mat4();
-	model = glm::rotate(model, 2.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 10759), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(20 * 3, 8.0f, 0.0f)); //x=3.5f.
-	model = glm::rotate(model, toRadians* (angle / 0.4f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(1.0f, 0.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	saturn.RenderModel();
-
-	//Saturn Orbit.
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(12.8f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-
-#pragma endregion
-
-#pragma region Uranus
-	//Uranus.
-	model = glm::mat4();
-	model = glm::rotate(model, 1.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 30685), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(25 * 3, 8.0f, 0.0f)); //x=3.5f.
-	model = glm::rotate(model, toRadians* (angle / -0.7f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.002f, 0.002f, 0.002f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	uranus.RenderModel();
-
-	//Uranus Orbit.
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(16.1f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-#pragma endregion
-
-#pragma region Neptune
-	//Neptune.
-	model = glm::mat4();
-	model = glm::rotate(model, 2.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, 360.0f * toRadians * (angle / 60190), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::translate(model, glm::vec3(30 * 3, 8.0f, 0.0f)); //x=3.5f.
-	model = glm::rotate(model, toRadians* (angle / 0.7f), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, -90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(0.002f, 0.002f, 0.002f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	neptune.RenderModel();
-
-	//Neptune Orbit.
-	model = glm::mat4();
-	model = glm::translate(model, glm::vec3(0.0f, 8.0f, 0.0f));
-	model = glm::scale(model, glm::vec3(19.3f));
-	glUniformMatrix4fv(uniformModel, 1, GL_FALSE, glm::value_ptr(model));
-	shinyMaterial.UseMaterial(uniformSpecularIntensity, uniformShininess);
-	orbit.RenderModel();
-#pragma endregion
-
-#pragma endregion
+	solarSystem.RenderScene(uniformModel, uniformInstanced, uniformUseTextureArray, uniformSpecularIntensity, uniformShininess, casters, views, culled, pass);
 }
 
 void DirectionalShadowMapPass(DirectionalLight *light)
 {
+	CPU_ZONE("DirectionalShadowMapPass");
+	GpuScope scope("Directional shadow");
+
 	directionalShadowShader.UseShader();
 
 	glViewport(0, 0, light->GetShadowMap()->GetShadowWidth(), light->GetShadowMap()->GetShadowHeight());
@@ -491,71 +338,158 @@ void DirectionalShadowMapPass(DirectionalLight *light)
 	glClear(GL_DEPTH_BUFFER_BIT);
 
 	uniformModel = directionalShadowShader.GetModelLocation();
-	directionalShadowShader.SetDirectionalLightTransform(&light->CalculateLightTransform());
+	uniformInstanced = directionalShadowShader.GetInstancedLocation();
+	uniformUseTextureArray = directionalShadowShader.GetUseTextureArrayLocation();
+	glm::mat4 lightTransform = light->CalculateLightTransform();
+	directionalShadowShader.SetDirectionalLightTransform(&lightTransform);
 
 	directionalShadowShader.Validate();
 
-	RenderScene();
+	//Only bodies inside the light's ortho box can cast into the map.
+	solarSystem.CullFrustum("Directional shadow", lightTransform);
+	RenderScene(PASS_DIRECTIONAL_SHADOW, ALL_CASTERS, 1, true);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void OmniShadowMapPass(PointLight *light)
+//Draws casters into the cube map last bound with Write or WriteStatic.
+//Single-draw modes use the light's range culling, per-face draws cull against each face.
+void RenderOmniCasters(OmniShadowMap* shadowMap, bool toStatic, CasterSet casters,
+	const char* name, const vector<glm::mat4>& faceTransforms)
+{
+	switch (omniShadowMode)
+	{
+	case OMNI_LAYERED:
+		RenderScene(PASS_OMNI_SHADOW, casters, 6, true);
+		break;
+
+	case OMNI_PER_FACE:
+		for (GLuint face = 0; face < 6; face++)
+		{
+			if (toStatic)
+			{
+				shadowMap->WriteStaticFace(face);
+			}
+			else
+			{
+				shadowMap->WriteFace(face);
+			}
+
+			char faceName[64];
+			snprintf(faceName, sizeof(faceName), "%s face %u", name, face);
+			solarSystem.CullFrustum(faceName, faceTransforms[face]);
+
+			omniFaceShader.SetFace(face);
+			RenderScene(PASS_OMNI_SHADOW, casters, 1, true);
+		}
+		break;
+
+	default:
+		RenderScene(PASS_OMNI_SHADOW, casters, 1, true);
+		break;
+	}
+}
+
+void OmniShadowMapPass(PointLight *light, const char* name)
 {
+	CPU_ZONE("OmniShadowMapPass");
+	GpuScope scope(name);
+
 	glViewport(0, 0, light->GetShadowMap()->GetShadowWidth(), light->GetShadowMap()->GetShadowHeight());
 
-	omniShadowShader.UseShader();
-	uniformModel = omniShadowShader.GetModelLocation();
-	uniformOmniLightPos = omniShadowShader.GetOmniLightPosLocation();
-	uniformFarPlane = omniShadowShader.GetFarPlaneLocation();
+	Shader* omniShader = GetOmniShader();
 
-	light->GetShadowMap()->Write();
+	omniShader->UseShader();
+	uniformModel = omniShader->GetModelLocation();
+	uniformInstanced = omniShader->GetInstancedLocation();
+	uniformUseTextureArray = omniShader->GetUseTextureArrayLocation();
+	uniformOmniLightPos = omniShader->GetOmniLightPosLocation();
+	uniformFarPlane = omniShader->GetFarPlaneLocation();
 
-	glClear(GL_DEPTH_BUFFER_BIT);
+	GLState::Uniform3f(uniformOmniLightPos, light->GetPosition().x, light->GetPosition().y, light->GetPosition().z);
+	GLState::Uniform1f(uniformFarPlane, light->GetFarPlane());
+	vector<glm::mat4> faceTransforms = light->CalculateLightTransform();
+	omniShader->SetLightMatrices(faceTransforms);
 
-	glUniform3f(uniformOmniLightPos, light->GetPosition().x, light->GetPosition().y, light->GetPosition().z);
-	glUniform1f(uniformFarPlane, light->GetFarPlane());
-	omniShadowShader.SetLightMatrices(light->CalculateLightTransform());
+	omniShader->Validate();
 
-	omniShadowShader.Validate();
+	//Nothing beyond the far plane can reach the cube map.
+	if (omniShadowMode != OMNI_PER_FACE)
+	{
+		solarSystem.CullSphere(name, light->GetPosition(), light->GetFarPlane());
+	}
 
-	RenderScene();
+	//A light that held still since last frame reuses its baked static casters.
+	OmniShadowMap* shadowMap = light->GetOmniShadowMap();
+	if (!shadowMap->UpdateCacheKey(light->GetPosition(), light->GetFarPlane(), solarSystem.GetStaticVersion()))
+	{
+		shadowMap->Write();
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		RenderOmniCasters(shadowMap, false, ALL_CASTERS, name, faceTransforms);
+	}
+	else
+	{
+		if (!shadowMap->IsStaticCacheValid())
+		{
+			GpuScope bakeScope("Static bake");
+
+			shadowMap->WriteStatic();
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+			RenderOmniCasters(shadowMap, true, STATIC_CASTERS, name, faceTransforms);
+			shadowMap->FinishStatic();
+		}
+
+		{
+			GpuScope copyScope("Static copy");
+			shadowMap->CopyStatic();
+		}
+
+		shadowMap->Write();
+		RenderOmniCasters(shadowMap, false, DYNAMIC_CASTERS, name, faceTransforms);
+	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void RenderPass(glm::mat4 projectionMatrix, glm::mat4 viewMatrix)
 {
-	glViewport(0, 0, 1366, 768);
+	CPU_ZONE("RenderPass");
+	GpuScope scope("Main pass");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	glViewport(0, 0, sceneWidth, sceneHeight);
 
 	//Clear Window.
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	skyBox.DrawSkybox(viewMatrix, projectionMatrix);
+	{
+		CPU_ZONE("DrawSkybox");
+		GpuScope skyboxScope("Skybox");
+		skyBox->DrawSkybox(viewMatrix, projectionMatrix);
+	}
 
 	shaderList[0].UseShader();
 
 	uniformModel = shaderList[0].GetModelLocation();
-	uniformProjection = shaderList[0].GetProjectionLocation();
-	uniformView = shaderList[0].GetViewLocation();
-
-	uniformEyePosition = shaderList[0].GetEyePositionLocation();
+	uniformInstanced = shaderList[0].GetInstancedLocation();
+	uniformUseTextureArray = shaderList[0].GetUseTextureArrayLocation();
 	uniformSpecularIntensity = shaderList[0].GetSpecularIntensityLocation();
 	uniformShininess = shaderList[0].GetShininessLocation();
 
-	glUniformMatrix4fv(uniformProjection, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-	glUniformMatrix4fv(uniformView, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-	glUniform3f(uniformEyePosition, camera.getCameraPosition().x, camera.getCameraPosition().y, camera.getCameraPosition().z);
-
-	shaderList[0].SetDirectionalLight(&mainLight);
+	//Camera and light data come from the frame's uniform blocks.
 	shaderList[0].SetPointLights(pointLights, pointLightCount, 3, 0);
 	shaderList[0].SetSpotLights(spotLights, spotLightCount, 3 + pointLightCount, pointLightCount);
-	shaderList[0].SetDirectionalLightTransform(&mainLight.CalculateLightTransform());
+
+	clusteredLights.Update(solarSystem.GetLights(), viewMatrix, projectionMatrix, sceneWidth, sceneHeight);
+	shaderList[0].SetClusteredLights(&clusteredLights, CLUSTER_TEXTURE_UNIT);
 
 	mainLight.GetShadowMap()->Read(GL_TEXTURE2); //2 1
 
 	shaderList[0].SetTexture(1);//1  0
+	shaderList[0].SetTextureArray(PLANET_TEXTURE_UNIT);
 	shaderList[0].SetDirectionalShadowMap(2);//2  1
 
 	//mainLight.UseLight(uniformAmbientIntensity, uniformAmbientColour,
@@ -567,30 +501,71 @@ void RenderPass(glm::mat4 projectionMatrix, glm::mat4 viewMatrix)
 
 	shaderList[0].Validate();
 
-	RenderScene();
+	//Skip bodies and meshes outside the camera frustum, and bodies under a pixel across.
+	solarSystem.CullFrustum("Main pass", projectionMatrix * viewMatrix, true);
+	RenderScene(PASS_MAIN, ALL_CASTERS, 1, true);
 }
 
-int main()
+int main(int argc, char** argv)
 {
 #pragma region General Init
+	//--omni is handled here, everything else belongs to the benchmark.
+	vector<char*> arguments(1, argv[0]);
+	OmniShadowMode requestedOmniMode = OMNI_GEOMETRY_SHADER;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--omni") == 0 && i + 1 < argc)
+		{
+			i++;
+			int m = 0;
+			while (m < OMNI_MODE_COUNT && strcmp(argv[i], omniShadowModeNames[m]) != 0)
+			{
+				m++;
+			}
+
+			if (m == OMNI_MODE_COUNT)
+			{
+				printf("Expected --omni geometry|layered|faces\n");
+				return 1;
+			}
+
+			requestedOmniMode = (OmniShadowMode)m;
+		}
+		else
+		{
+			arguments.push_back(argv[i]);
+		}
+	}
+
+	if (!benchmark.ParseArguments(arguments.size(), &arguments[0]))
+	{
+		return 1;
+	}
+
+	CpuProfiler::SetThreadName("Main");
+
 	dirX = -176.0f;
 	dirY = -122.0f;
 	dirZ = -45.0f;
 
-	mainWindow = Window(1366, 768);
-	mainWindow.Initialise();
+	mainWindow = benchmark.IsEnabled() ? Window(benchmark.GetWidth(), benchmark.GetHeight()) : Window(1366, 768);
+	if (mainWindow.Initialise(benchmark.IsEnabled()) != 0)
+	{
+		return 1;
+	}
+
+	sceneWidth = mainWindow.getBufferWidth();
+	sceneHeight = mainWindow.getBufferHeight();
 
 	CreateObjects();
 	CreateShaders();
+	SetOmniShadowMode(requestedOmniMode);
 
 	camera = Camera(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -60.0f, 0.0f, 5.0f, 0.5f);
 
-	brickTexture = Texture("Textures/brick.png");
-	brickTexture.LoadTextureA();
-	dirtTexture = Texture("Textures/dirt.png");
-	dirtTexture.LoadTextureA();
-	plainTexture = Texture("Textures/plain.png");
-	plainTexture.LoadTextureA();
+	brickTexture = TextureCache::AcquireTexture("Textures/brick.png", true);
+	dirtTexture = TextureCache::AcquireTexture("Textures/dirt.png", true);
+	plainTexture = TextureCache::AcquireTexture("Textures/plain.png", true);
 
 	shinyMaterial = Material(4.0f, 256);
 	dullMaterial = Material(0.3f, 4);
@@ -602,38 +577,22 @@ int main()
 	blackHawk = Model();
 	blackHawk.LoadModel("Models/uh60.obj");
 
-	earthPlanet = Model();
-	earthPlanet.LoadModel("Models/Earth.obj");
-
-	sun = Model();
-	sun.LoadModel("Models/Sole.obj");
-
-	moon = Model();
-	moon.LoadModel("Models/Luna.obj");
-
-	saturn = Model();
-	saturn.LoadModel("Models/Saturno.obj");
-
-	mars = Model();
-	mars.LoadModel("Models/Marte.obj");
-
-	mercury = Model();
-	mercury.LoadModel("Models/Mercurio.obj");
-
-	venus = Model();
-	venus.LoadModel("Models/Venere.obj");
-
-	jupiter = Model();
-	jupiter.LoadModel("Models/Giove.obj");
-
-	uranus = Model();
-	uranus.LoadModel("Models/Urano.obj");
+	if (!solarSystem.LoadScene(sceneFile))
+	{
+		return 1;
+	}
 
-	neptune = Model();
-	neptune.LoadModel("Models/Nettuno.obj");
+	//The lit shader always samples the cluster buffers, so there is no drawing without them.
+	if (!clusteredLights.Init())
+	{
+		return 1;
+	}
 
-	orbit = Model();
-	orbit.LoadModel("Models/Orbit.obj");
+	//Every shader reads its camera and lights from these blocks.
+	if (!frameUniforms.Init())
+	{
+		return 1;
+	}
 #pragma endregion
 
 #pragma region DirectionalLight
@@ -693,27 +652,77 @@ int main()
 	skyboxFaces.push_back("Textures/skybox/purplenebula_bk.tga");
 	skyboxFaces.push_back("Textures/skybox/purplenebula_ft.tga");
 
-	skyBox = Skybox(skyboxFaces);
+	skyBox = new Skybox(skyboxFaces);
 #pragma endregion
 
-	glm::mat4 projection = glm::perspective(glm::radians(60.0f), (GLfloat)mainWindow.getBufferWidth() / mainWindow.getBufferHeight(), 0.1f, 100.0f);
+	printf("Texture cache: %u hit(s), %u miss(es)\n", TextureCache::GetHitCount(), TextureCache::GetMissCount());
+	printf("Program cache: %u hit(s), %u miss(es)\n", ProgramCache::GetHitCount(), ProgramCache::GetMissCount());
+	GeometryArena::PrintStats();
+	printf("Scene draws: %s\n", GeometryArena::IsIndirectSupported() ? "multi-draw indirect" : "base vertex fallback");
+
+	if (benchmark.IsEnabled())
+	{
+		if (!benchmark.CreateTarget())
+		{
+			return 1;
+		}
+
+		sceneFramebuffer = benchmark.GetFramebuffer();
+		sceneWidth = benchmark.GetWidth();
+		sceneHeight = benchmark.GetHeight();
+
+		//Time rendering only, not texture streaming.
+		TextureLoader::WaitAll();
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), (GLfloat)sceneWidth / sceneHeight, 0.1f, 100.0f);
 
 #pragma endregion
 
 #pragma region GameLoop
 	// Loop until window closed
-	while (!mainWindow.getShouldClose())
+	while (benchmark.IsEnabled() ? !benchmark.IsFinished() : !mainWindow.getShouldClose())
 	{
-		GLfloat now = glfwGetTime(); // SDL_GetPerformanceCounter();
-		deltaTime = now - lastTime; // (now - lastTime)*1000/SDL_GetPerformanceFrequency();
-		lastTime = now;
+		CPU_ZONE("Frame");
+		GpuProfiler::BeginFrame();
+
+		if (benchmark.IsEnabled())
+		{
+			//Fixed step and no input, so every run renders the same frames.
+			benchmark.BeginFrame();
+			deltaTime = benchmark.GetTimeStep();
+		}
+		else
+		{
+			GLfloat now = glfwGetTime(); // SDL_GetPerformanceCounter();
+			deltaTime = now - lastTime; // (now - lastTime)*1000/SDL_GetPerformanceFrequency();
+			lastTime = now;
+		}
 
 		// Get + Handle User Input
-		glfwPollEvents();
+		{
+			CPU_ZONE("glfwPollEvents");
+			glfwPollEvents();
+		}
+
+		//Commit textures the loader threads have finished decoding.
+		{
+			CPU_ZONE("TextureLoader::Update");
+			TextureLoader::Update();
+		}
+
+		if (!benchmark.IsEnabled())
+		{
+			{
+				CPU_ZONE("keyControl");
+				camera.keyControl(mainWindow.getsKeys(), deltaTime);
+			}
+			{
+				CPU_ZONE("mouseControl");
+				camera.mouseControl(mainWindow.getXChange(), mainWindow.getYChange());
+			}
+		}
 
-		camera.keyControl(mainWindow.getsKeys(), deltaTime);
-		camera.mouseControl(mainWindow.getXChange(), mainWindow.getYChange());
-		
 		//On/Off SpotLight.
 		if (mainWindow.getsKeys()[GLFW_KEY_L])
 		{
@@ -721,6 +730,29 @@ int main()
 			mainWindow.getsKeys()[GLFW_KEY_L] = false;
 		}
 
+		//Print GPU pass timings, culling and GL state stats.
+		if (mainWindow.getsKeys()[GLFW_KEY_P])
+		{
+			GpuProfiler::Print();
+			solarSystem.PrintCullStats();
+			GLState::Print();
+			mainWindow.getsKeys()[GLFW_KEY_P] = false;
+		}
+
+		//Cycle omni shadow modes to compare them.
+		if (mainWindow.getsKeys()[GLFW_KEY_O])
+		{
+			SetOmniShadowMode((OmniShadowMode)((omniShadowMode + 1) % OMNI_MODE_COUNT));
+			mainWindow.getsKeys()[GLFW_KEY_O] = false;
+		}
+
+		//Dump CPU zones recorded since the last dump.
+		if (mainWindow.getsKeys()[GLFW_KEY_T])
+		{
+			CpuProfiler::WriteTrace("cpu_trace.json");
+			mainWindow.getsKeys()[GLFW_KEY_T] = false;
+		}
+
 		#pragma region  Debug
 	/*if (mainWindow.getsKeys()[GLFW_KEY_UP])
 		{
@@ -758,26 +790,75 @@ int main()
 		system("CLS");*/
 #pragma endregion
 
+		angle += 12.0f * deltaTime; //Same speed as when each of the six passes advanced it.
+		{
+			CPU_ZONE("Scene::Update");
+			solarSystem.Update(angle);
+			solarSystem.SelectLods(camera.getCameraPosition(), sceneHeight * 0.5f * projection[1][1]);
+		}
+
 		DirectionalShadowMapPass(&mainLight);
 		mainLight.SetLocationDir(glm::vec3(0.0f), glm::vec3(dirX, dirY, dirZ));
 
-		for (size_t i = 0; i < pointLightCount; i++)
 		{
-			OmniShadowMapPass(&pointLights[i]);
+			GpuScope omniScope("Omni shadows");
+			char lightName[32];
+
+			for (size_t i = 0; i < pointLightCount; i++)
+			{
+				snprintf(lightName, sizeof(lightName), "Point light %zu", i);
+				OmniShadowMapPass(&pointLights[i], lightName);
+			}
+
+			for (size_t i = 0; i < spotLightCount; i++)
+			{
+				snprintf(lightName, sizeof(lightName), "Spot light %zu", i);
+				OmniShadowMapPass(&spotLights[i], lightName);
+			}
 		}
 
-		for (size_t i = 0; i < spotLightCount; i++)
+		//Every program reads camera and lights from one upload.
 		{
-			OmniShadowMapPass(&spotLights[i]);
+			CPU_ZONE("FrameUniforms::Upload");
+			frameUniforms.SetCamera(projection, camera.CalculateViewMatrix(), camera.getCameraPosition());
+			frameUniforms.SetLights(&mainLight, pointLights, pointLightCount, spotLights, spotLightCount);
+			frameUniforms.Upload();
 		}
 
 		RenderPass(projection, camera.CalculateViewMatrix());
 
-		glUseProgram(0);
+		//The last program stays bound, GLState skips it if the next frame starts with it.
+		GLState::EndFrame();
+		GpuProfiler::EndFrame();
 
-		mainWindow.swapBuffers();
+		if (benchmark.IsEnabled())
+		{
+			benchmark.EndFrame();
+		}
+		else
+		{
+			CPU_ZONE("glfwSwapBuffers");
+			mainWindow.swapBuffers();
+		}
 	}
 #pragma endregion
 
+	if (benchmark.IsEnabled())
+	{
+		benchmark.WriteResults();
+		benchmark.ClearTarget();
+		GpuProfiler::Print();
+		solarSystem.PrintCullStats();
+		GLState::Print();
+		CpuProfiler::WriteTrace("cpu_trace.json");
+	}
+
+	delete skyBox;
+	TextureLoader::Stop();
+	GpuProfiler::Clear();
+	clusteredLights.ClearClusters();
+	frameUniforms.ClearUniforms();
+	GeometryArena::Clear();
+
 	return 0;
 }
\ No newline at end of file
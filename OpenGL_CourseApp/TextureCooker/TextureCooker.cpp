@@ -0,0 +1,438 @@
+//Offline texture cooker: converts every image under a directory (Textures/ by default)
+//into a block-compressed KTX file next to it, with the full mip chain baked in.
+//Opaque images become BC1, images with any transparency become BC3.
+//Texture, Skybox and the planet texture array pick up the .ktx in place of the source.
+//
+//Usage: TextureCooker [directory] [-f]
+//  -f	re-cook files whose .ktx is already newer than the source.
+
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "../OpenGL_CourseApp/stb_image.h"
+
+using namespace std;
+
+//GL enums, the cooker does not link against OpenGL.
+const uint32_t GL_RGB = 0x1907;
+const uint32_t GL_RGBA = 0x1908;
+const uint32_t GL_COMPRESSED_RGB_S3TC_DXT1_EXT = 0x83F0;
+const uint32_t GL_COMPRESSED_RGBA_S3TC_DXT5_EXT = 0x83F3;
+
+struct Image
+{
+	int width, height;
+	vector<unsigned char> pixels; //RGBA
+};
+
+#pragma region Mips
+
+Image Downsample(const Image& source)
+{
+	Image result;
+	result.width = max(source.width / 2, 1);
+	result.height = max(source.height / 2, 1);
+	result.pixels.resize(result.width * result.height * 4);
+
+	for (int y = 0; y < result.height; y++)
+	{
+		int y0 = min(y * 2, source.height - 1), y1 = min(y * 2 + 1, source.height - 1);
+
+		for (int x = 0; x < result.width; x++)
+		{
+			int x0 = min(x * 2, source.width - 1), x1 = min(x * 2 + 1, source.width - 1);
+
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = source.pixels[(y0 * source.width + x0) * 4 + c] + source.pixels[(y0 * source.width + x1) * 4 + c]
+					+ source.pixels[(y1 * source.width + x0) * 4 + c] + source.pixels[(y1 * source.width + x1) * 4 + c];
+				result.pixels[(y * result.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+
+	return result;
+}
+
+#pragma endregion
+
+#pragma region Block compression
+
+uint16_t To565(const int* colour)
+{
+	return (uint16_t)(((colour[0] * 31 + 127) / 255) << 11 | ((colour[1] * 63 + 127) / 255) << 5 | ((colour[2] * 31 + 127) / 255));
+}
+
+void From565(uint16_t packed, int* colour)
+{
+	int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+	colour[0] = (r << 3) | (r >> 2);
+	colour[1] = (g << 2) | (g >> 4);
+	colour[2] = (b << 3) | (b >> 2);
+}
+
+//Endpoints from the inset bounding box of the block, indices by nearest palette entry.
+void CompressColourBlock(const unsigned char* block, unsigned char* output)
+{
+	int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			low[c] = min(low[c], (int)block[i * 4 + c]);
+			high[c] = max(high[c], (int)block[i * 4 + c]);
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+	{
+		int inset = (high[c] - low[c]) / 16;
+		low[c] += inset;
+		high[c] -= inset;
+	}
+
+	uint16_t colour0 = To565(high), colour1 = To565(low);
+	uint32_t indices = 0;
+
+	//Keep colour0 > colour1 so the block decodes in four-colour mode.
+	if (colour0 < colour1)
+	{
+		swap(colour0, colour1);
+	}
+
+	if (colour0 != colour1)
+	{
+		int palette[4][3];
+		From565(colour0, palette[0]);
+		From565(colour1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int delta = block[i * 4 + c] - palette[p][c];
+					distance += delta * delta;
+				}
+
+				if (distance < bestDistance)
+				{
+					best = p;
+					bestDistance = distance;
+				}
+			}
+
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	output[0] = colour0 & 0xFF;
+	output[1] = colour0 >> 8;
+	output[2] = colour1 & 0xFF;
+	output[3] = colour1 >> 8;
+	memcpy(output + 4, &indices, 4);
+}
+
+void CompressAlphaBlock(const unsigned char* block, unsigned char* output)
+{
+	int low = 255, high = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		low = min(low, (int)block[i * 4 + 3]);
+		high = max(high, (int)block[i * 4 + 3]);
+	}
+
+	output[0] = (unsigned char)high;
+	output[1] = (unsigned char)low;
+
+	//Eight-value mode: 0 is alpha0, 1 is alpha1, 2-7 interpolate between them.
+	uint64_t indices = 0;
+	if (high != low)
+	{
+		int palette[8] = { high, low };
+		for (int p = 1; p < 7; p++)
+		{
+			palette[p + 1] = ((7 - p) * high + p * low) / 7;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0;
+			for (int p = 1; p < 8; p++)
+			{
+				if (abs(block[i * 4 + 3] - palette[p]) < abs(block[i * 4 + 3] - palette[best]))
+				{
+					best = p;
+				}
+			}
+
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		output[2 + i] = (unsigned char)(indices >> (i * 8));
+	}
+}
+
+vector<unsigned char> CompressImage(const Image& image, bool hasAlpha)
+{
+	int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+	int blockSize = hasAlpha ? 16 : 8;
+
+	vector<unsigned char> output(blocksX * blocksY * blockSize);
+	unsigned char block[64];
+
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			//Edge blocks repeat the last row and column.
+			for (int i = 0; i < 16; i++)
+			{
+				int x = min(bx * 4 + i % 4, image.width - 1), y = min(by * 4 + i / 4, image.height - 1);
+				memcpy(block + i * 4, &image.pixels[(y * image.width + x) * 4], 4);
+			}
+
+			unsigned char* target = &output[(by * blocksX + bx) * blockSize];
+			if (hasAlpha)
+			{
+				CompressAlphaBlock(block, target);
+				CompressColourBlock(block, target + 8);
+			}
+			else
+			{
+				CompressColourBlock(block, target);
+			}
+		}
+	}
+
+	return output;
+}
+
+#pragma endregion
+
+#pragma region Files
+
+bool CookTexture(const string& source, const string& target)
+{
+	Image image;
+	int channels;
+	unsigned char* pixels = stbi_load(source.c_str(), &image.width, &image.height, &channels, 4);
+
+	if (!pixels)
+	{
+		printf("Failed to load %s\n", source.c_str());
+		return false;
+	}
+
+	image.pixels.assign(pixels, pixels + image.width * image.height * 4);
+	stbi_image_free(pixels);
+
+	bool hasAlpha = false;
+	for (size_t i = 3; i < image.pixels.size() && !hasAlpha; i += 4)
+	{
+		hasAlpha = image.pixels[i] != 255;
+	}
+
+	uint32_t levelCount = 1;
+	for (int size = max(image.width, image.height); size > 1; size /= 2)
+	{
+		levelCount++;
+	}
+
+	FILE* file = fopen(target.c_str(), "wb");
+	if (!file)
+	{
+		printf("Failed to write %s\n", target.c_str());
+		return false;
+	}
+
+	const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+	uint32_t header[13] = {
+		0x04030201,	//Endianness
+		0, 1, 0,	//glType, glTypeSize, glFormat: compressed.
+		hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+		hasAlpha ? GL_RGBA : GL_RGB,
+		(uint32_t)image.width, (uint32_t)image.height, 0,
+		0, 1,		//Array elements, faces.
+		levelCount,
+		0			//Key/value data.
+	};
+
+	fwrite(identifier, sizeof(identifier), 1, file);
+	fwrite(header, sizeof(header), 1, file);
+
+	size_t totalSize = 0;
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		vector<unsigned char> blocks = CompressImage(image, hasAlpha);
+		uint32_t imageSize = blocks.size();
+
+		fwrite(&imageSize, sizeof(imageSize), 1, file);
+		fwrite(&blocks[0], 1, blocks.size(), file);
+		totalSize += blocks.size();
+
+		if (level + 1 < levelCount)
+		{
+			image = Downsample(image);
+		}
+	}
+
+	bool ok = !ferror(file);
+	ok = fclose(file) == 0 && ok;
+
+	if (!ok)
+	{
+		printf("Failed to write %s\n", target.c_str());
+		remove(target.c_str());
+		return false;
+	}
+
+	printf("%s -> %s (%s, %u levels, %zu KB)\n", source.c_str(), target.c_str(), hasAlpha ? "BC3" : "BC1", levelCount, totalSize / 1024);
+	return true;
+}
+
+bool IsImage(const string& fileName)
+{
+	size_t dot = fileName.rfind('.');
+	if (dot == string::npos)
+	{
+		return false;
+	}
+
+	string extension = fileName.substr(dot + 1);
+	transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	return extension == "png" || extension == "jpg" || extension == "jpeg" || extension == "tga" || extension == "bmp";
+}
+
+bool IsStale(const string& source, const string& target)
+{
+	struct stat sourceInfo, targetInfo;
+	if (stat(target.c_str(), &targetInfo) != 0 || stat(source.c_str(), &sourceInfo) != 0)
+	{
+		return true;
+	}
+
+	return sourceInfo.st_mtime > targetInfo.st_mtime;
+}
+
+void ListDirectory(const string& directory, vector<string>& files, vector<string>& directories)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA entry;
+	HANDLE find = FindFirstFileA((directory + "/*").c_str(), &entry);
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		string name = entry.cFileName;
+		if (name == "." || name == "..") continue;
+
+		if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) directories.push_back(directory + "/" + name);
+		else files.push_back(directory + "/" + name);
+	} while (FindNextFileA(find, &entry));
+
+	FindClose(find);
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (!dir)
+	{
+		return;
+	}
+
+	while (dirent* entry = readdir(dir))
+	{
+		string name = entry->d_name;
+		if (name == "." || name == "..") continue;
+
+		string path = directory + "/" + name;
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) continue;
+
+		if (S_ISDIR(info.st_mode)) directories.push_back(path);
+		else files.push_back(path);
+	}
+
+	closedir(dir);
+#endif
+}
+
+#pragma endregion
+
+int main(int argc, char** argv)
+{
+	string directory = "Textures";
+	bool force = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-f") == 0) force = true;
+		else directory = argv[i];
+	}
+
+	unsigned int cooked = 0, skipped = 0, failed = 0;
+
+	vector<string> pending(1, directory);
+	while (!pending.empty())
+	{
+		string current = pending.back();
+		pending.pop_back();
+
+		vector<string> files;
+		ListDirectory(current, files, pending);
+		sort(files.begin(), files.end());
+
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			if (!IsImage(files[i])) continue;
+
+			string target = files[i].substr(0, files[i].rfind('.')) + ".ktx";
+
+			if (!force && !IsStale(files[i], target))
+			{
+				skipped++;
+			}
+			else if (CookTexture(files[i], target))
+			{
+				cooked++;
+			}
+			else
+			{
+				failed++;
+			}
+		}
+	}
+
+	printf("Cooked %u texture(s), %u up to date, %u failed\n", cooked, skipped, failed);
+
+	return failed == 0 ? 0 : 1;
+}